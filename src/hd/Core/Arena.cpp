@@ -0,0 +1,107 @@
+#include "Arena.hpp"
+#include "Log.hpp"
+#include <cstdlib>
+
+namespace hd {
+
+static thread_local Arena *gCurrentArena = nullptr;
+
+Arena::Arena(size_t blockSize) : mBlockSize(blockSize), mOffset(0), mUsedSize(0) {
+    HD_ASSERT(blockSize > 0);
+}
+
+Arena::~Arena() {
+    reset();
+    for (auto &block : mBlocks) {
+        std::free(block.data);
+    }
+    HD_ASSERT(gCurrentArena != this);
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+    HD_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    mUsedSize += size;
+    if (size > mBlockSize / 4) {
+        // Large requests, e.g. big arrays growing, get a block of their own, so the space left in the
+        // current block is still used
+        Block block = createBlock(size + alignment);
+        mLargeBlocks.push_back(block);
+        return block.data + getPadding(block.data, alignment);
+    }
+    if (!mBlocks.empty()) {
+        uint8_t *data = mBlocks.back().data + mOffset;
+        size_t offset = mOffset + getPadding(data, alignment);
+        if (offset + size <= mBlocks.back().size) {
+            mOffset = offset + size;
+            return mBlocks.back().data + offset;
+        }
+    }
+    mBlocks.push_back(createBlock(mBlockSize));
+    mOffset = getPadding(mBlocks.back().data, alignment) + size;
+    return mBlocks.back().data + mOffset - size;
+}
+
+void Arena::reset() {
+    for (auto &block : mLargeBlocks) {
+        std::free(block.data);
+    }
+    mLargeBlocks.clear();
+    for (size_t i = 1; i < mBlocks.size(); i++) {
+        std::free(mBlocks[i].data);
+    }
+    if (mBlocks.size() > 1) {
+        mBlocks.resize(1);
+    }
+    mOffset = 0;
+    mUsedSize = 0;
+}
+
+size_t Arena::getUsedSize() const {
+    return mUsedSize;
+}
+
+size_t Arena::getReservedSize() const {
+    size_t size = 0;
+    for (auto &block : mBlocks) {
+        size += block.size;
+    }
+    for (auto &block : mLargeBlocks) {
+        size += block.size;
+    }
+    return size;
+}
+
+Arena *Arena::getCurrent() {
+    return gCurrentArena;
+}
+
+void Arena::setCurrent(Arena *arena) {
+    gCurrentArena = arena;
+}
+
+void *Arena::allocateCurrent(size_t size, size_t alignment) {
+    HD_ASSERT(gCurrentArena);
+    return gCurrentArena->allocate(size, alignment);
+}
+
+Arena::Block Arena::createBlock(size_t size) {
+    Block block;
+    block.data = static_cast<uint8_t *>(std::malloc(size));
+    block.size = size;
+    HD_ASSERT(block.data);
+    return block;
+}
+
+size_t Arena::getPadding(const uint8_t *data, size_t alignment) {
+    return (alignment - (reinterpret_cast<uintptr_t>(data) & (alignment - 1))) & (alignment - 1);
+}
+
+ArenaScope::ArenaScope(Arena &arena) : mPrevious(Arena::getCurrent()) {
+    Arena::setCurrent(&arena);
+}
+
+ArenaScope::~ArenaScope() {
+    Arena::setCurrent(mPrevious);
+}
+
+}
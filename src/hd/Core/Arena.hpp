@@ -0,0 +1,84 @@
+#pragma once
+#include "Common.hpp"
+#include <vector>
+
+namespace hd {
+
+// Monotonic allocator: allocations bump a pointer inside large blocks and are never freed one by one,
+// everything is released at once by reset() or the destructor
+class Arena : public Noncopyable {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 1024*1024;
+
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment);
+    // Invalidates all allocations, the first block is kept for reuse
+    void reset();
+
+    size_t getUsedSize() const;
+    size_t getReservedSize() const;
+
+    // Arena used by ArenaAllocator on the calling thread, see ArenaScope
+    static Arena *getCurrent();
+    static void setCurrent(Arena *arena);
+    static void *allocateCurrent(size_t size, size_t alignment);
+
+private:
+    struct Block {
+        uint8_t *data;
+        size_t size;
+    };
+
+    static Block createBlock(size_t size);
+    static size_t getPadding(const uint8_t *data, size_t alignment);
+
+    std::vector<Block> mBlocks;
+    std::vector<Block> mLargeBlocks;
+    size_t mBlockSize;
+    size_t mOffset; // in the last block
+    size_t mUsedSize;
+};
+
+// Makes an arena current on this thread for the scope lifetime
+class ArenaScope : public Noncopyable, public Nonmovable {
+public:
+    explicit ArenaScope(Arena &arena);
+    ~ArenaScope();
+
+private:
+    Arena *mPrevious;
+};
+
+// Stateless std allocator over Arena::getCurrent(), deallocation does nothing. Being stateless it works where
+// containers default-construct their allocators, e.g. as AllocatorType of nlohmann::basic_json (see ArenaJSON).
+// Containers must be created and grown while their arena is current and destroyed before it is reset.
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() = default;
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(Arena::allocateCurrent(count*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &) const {
+        return false;
+    }
+};
+
+}
@@ -42,6 +42,41 @@
 #   endif
 #endif
 
+// Instruction sets enabled for the build, kernels check these to pick SIMD code paths
+#if defined(HD_COMPILER_VC)
+#   if defined(HD_ARCH_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define HD_SIMD_SSE2
+#   endif
+#   ifdef __AVX__
+#       define HD_SIMD_SSE41
+#       define HD_SIMD_AVX
+#   endif
+#   ifdef __AVX2__
+#       define HD_SIMD_AVX2
+#       define HD_SIMD_FMA
+#       define HD_SIMD_F16C
+#   endif
+#elif defined(HD_COMPILER_GCC)
+#   ifdef __SSE2__
+#       define HD_SIMD_SSE2
+#   endif
+#   ifdef __SSE4_1__
+#       define HD_SIMD_SSE41
+#   endif
+#   ifdef __AVX__
+#       define HD_SIMD_AVX
+#   endif
+#   ifdef __AVX2__
+#       define HD_SIMD_AVX2
+#   endif
+#   ifdef __FMA__
+#       define HD_SIMD_FMA
+#   endif
+#   ifdef __F16C__
+#       define HD_SIMD_F16C
+#   endif
+#endif
+
 #if defined(HD_COMPILER_VC)
 #   define HD_FORCEINLINE __forceinline
 #elif defined(HD_COMPILER_GCC)
@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace hd {
+
+// Map stored as a vector of pairs sorted by key: one allocation for all entries instead of one per node,
+// binary search lookups and cache friendly iteration. Insertion and erasure move the following entries,
+// so it suits maps that are built once and mostly read, and appending keys in order stays cheap.
+// Iterators and references are invalidated by insertion and erasure.
+// The interface is the subset of std::map used by nlohmann::basic_json, so it can be its ObjectType.
+template<typename Key, typename T, typename Compare = std::less<>, typename Allocator = std::allocator<std::pair<const Key, T>>>
+class FlatMap {
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using Container = std::vector<value_type, allocator_type>;
+    using size_type = typename Container::size_type;
+    using difference_type = typename Container::difference_type;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using iterator = typename Container::iterator;
+    using const_iterator = typename Container::const_iterator;
+
+    FlatMap() = default;
+
+    template<typename InputIt>
+    FlatMap(InputIt first, InputIt last) {
+        insert(first, last);
+    }
+
+    FlatMap(std::initializer_list<value_type> values) {
+        insert(values.begin(), values.end());
+    }
+
+    iterator begin() { return mItems.begin(); }
+    const_iterator begin() const { return mItems.begin(); }
+    const_iterator cbegin() const { return mItems.cbegin(); }
+    iterator end() { return mItems.end(); }
+    const_iterator end() const { return mItems.end(); }
+    const_iterator cend() const { return mItems.cend(); }
+
+    bool empty() const { return mItems.empty(); }
+    size_type size() const { return mItems.size(); }
+    size_type max_size() const { return mItems.max_size(); }
+    void clear() { mItems.clear(); }
+    void reserve(size_type count) { mItems.reserve(count); }
+
+    template<typename K>
+    iterator find(const K &key) {
+        iterator it = lowerBound(key);
+        return it != mItems.end() && !mCompare(key, it->first) ? it : mItems.end();
+    }
+
+    template<typename K>
+    const_iterator find(const K &key) const {
+        return const_cast<FlatMap *>(this)->find(key);
+    }
+
+    template<typename K>
+    size_type count(const K &key) const {
+        return find(key) != mItems.end() ? 1 : 0;
+    }
+
+    template<typename K>
+    T &at(const K &key) {
+        iterator it = find(key);
+        if (it == mItems.end()) {
+            throw std::out_of_range("FlatMap::at");
+        }
+        return it->second;
+    }
+
+    template<typename K>
+    const T &at(const K &key) const {
+        return const_cast<FlatMap *>(this)->at(key);
+    }
+
+    T &operator[](const Key &key) {
+        return emplace(key, T()).first->second;
+    }
+
+    T &operator[](Key &&key) {
+        return emplace(std::move(key), T()).first->second;
+    }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> emplace(K &&key, Args &&...args) {
+        // Appending in key order, e.g. parsing sorted documents, skips the search
+        iterator it = mItems.empty() || mCompare(mItems.back().first, key) ? mItems.end() : lowerBound(key);
+        if (it != mItems.end() && !mCompare(key, it->first)) {
+            return { it, false };
+        }
+        it = mItems.emplace(it, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+        return { it, true };
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value) {
+        return emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value) {
+        return emplace(std::move(value.first), std::move(value.second));
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            emplace(first->first, first->second);
+        }
+    }
+
+    iterator erase(iterator pos) {
+        return mItems.erase(pos);
+    }
+
+    iterator erase(const_iterator pos) {
+        return mItems.erase(pos);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        return mItems.erase(first, last);
+    }
+
+    template<typename K>
+    size_type erase(const K &key) {
+        iterator it = find(key);
+        if (it == mItems.end()) {
+            return 0;
+        }
+        mItems.erase(it);
+        return 1;
+    }
+
+    bool operator==(const FlatMap &right) const { return mItems == right.mItems; }
+    bool operator!=(const FlatMap &right) const { return mItems != right.mItems; }
+    bool operator<(const FlatMap &right) const { return mItems < right.mItems; }
+    bool operator<=(const FlatMap &right) const { return mItems <= right.mItems; }
+    bool operator>(const FlatMap &right) const { return mItems > right.mItems; }
+    bool operator>=(const FlatMap &right) const { return mItems >= right.mItems; }
+
+private:
+    template<typename K>
+    iterator lowerBound(const K &key) {
+        return std::lower_bound(mItems.begin(), mItems.end(), key, [this](const value_type &item, const K &value) {
+            return mCompare(item.first, value);
+        });
+    }
+
+    Container mItems;
+    Compare mCompare;
+};
+
+}
@@ -1,103 +1,147 @@
 #include "JSON.hpp"
+#include "JSONVisitor.hpp"
+#include "Log.hpp"
+#include "StringUtils.hpp"
+#include "../IO/StreamInputBuffer.hpp"
+#include <istream>
 
 namespace hd {
 
-void from_json(const JSON &json, StringHash &data) {
-    data = StringHash(json.get<uint64_t>());
-}
-
-void from_json(const JSON &json, Color4 &data) {
-    data.r = json["r"].get<uint8_t>();
-    data.g = json["g"].get<uint8_t>();
-    data.b = json["b"].get<uint8_t>();
-    data.a = json["a"].get<uint8_t>();
-}
-
-void to_json(JSON &json, const StringHash &data) {
+static JSONFormat resolveFormat(const Stream &stream, JSONFormat format) {
+    return format == JSONFormat::Auto ? JSONUtils::getFormat(stream.getName()) : format;
+}
+
+template<typename T>
+static T readValue(Stream &stream, JSONFormat format) {
+    std::vector<uint8_t> buffer = stream.readAllBuffer();
+    try {
+        switch (resolveFormat(stream, format)) {
+            case JSONFormat::Auto:
+            case JSONFormat::Text: {
+                return T::parse(buffer.begin(), buffer.end());
+            }
+            case JSONFormat::CBOR: {
+                return T::from_cbor(buffer);
+            }
+            case JSONFormat::MessagePack: {
+                return T::from_msgpack(buffer);
+            }
+        }
+    }
+    catch (const nlohmann::detail::exception &e) {
+        HD_LOG_FATAL("Failed to load JSON from stream '{}'. Error: {}", stream.getName().data(), e.what());
+    }
+    return T();
+}
+
+JSON JSONUtils::read(Stream &stream, JSONFormat format) {
+    return readValue<JSON>(stream, format);
+}
+
+ArenaJSON JSONUtils::readArena(Stream &stream, JSONFormat format) {
+    HD_ASSERT(Arena::getCurrent());
+    return readValue<ArenaJSON>(stream, format);
+}
+
+void JSONUtils::write(Stream &stream, const JSON &json, JSONFormat format, int indent) {
+    std::vector<uint8_t> buffer;
+    switch (resolveFormat(stream, format)) {
+        case JSONFormat::Auto:
+        case JSONFormat::Text: {
+            std::string text = json.dump(indent);
+            HD_ASSERT(stream.write(text.data(), text.size()) == text.size());
+            return;
+        }
+        case JSONFormat::CBOR: {
+            JSON::to_cbor(json, buffer);
+            break;
+        }
+        case JSONFormat::MessagePack: {
+            JSON::to_msgpack(json, buffer);
+            break;
+        }
+    }
+    HD_ASSERT(stream.write(buffer.data(), buffer.size()) == buffer.size());
+}
+
+bool JSONUtils::parse(Stream &stream, JSONSAX &handler, JSONFormat format) {
+    nlohmann::detail::input_format_t inputFormat = nlohmann::detail::input_format_t::json;
+    switch (resolveFormat(stream, format)) {
+        case JSONFormat::Auto:
+        case JSONFormat::Text: {
+            inputFormat = nlohmann::detail::input_format_t::json;
+            break;
+        }
+        case JSONFormat::CBOR: {
+            inputFormat = nlohmann::detail::input_format_t::cbor;
+            break;
+        }
+        case JSONFormat::MessagePack: {
+            inputFormat = nlohmann::detail::input_format_t::msgpack;
+            break;
+        }
+    }
+    StreamInputBuffer buffer(stream);
+    std::istream input(&buffer);
+    return JSON::sax_parse(input, &handler, inputFormat);
+}
+
+void JSONUtils::parse(Stream &stream, JSONVisitor &visitor, JSONFormat format) {
+    JSONVisitorSAX handler(visitor);
+    if (!parse(stream, handler, format)) {
+        HD_LOG_FATAL("Failed to load JSON from stream '{}'. Error: {}", stream.getName().data(), handler.getError());
+    }
+}
+
+JSONFormat JSONUtils::getFormat(const std::string &path) {
+    if (StringUtils::endsWith(path, ".cbor", false)) {
+        return JSONFormat::CBOR;
+    }
+    if (StringUtils::endsWith(path, ".msgpack", false) || StringUtils::endsWith(path, ".mpk", false)) {
+        return JSONFormat::MessagePack;
+    }
+    return JSONFormat::Text;
+}
+
+template<typename BasicJSON>
+void from_json(const BasicJSON &json, StringHash &data) {
+    data = StringHash(json.template get<uint64_t>());
+}
+
+template<typename BasicJSON>
+void to_json(BasicJSON &json, const StringHash &data) {
     json = data.getHash();
 }
 
-void to_json(JSON &json, const Color4 &data) {
-    json["r"] = data.r;
-    json["g"] = data.g;
-    json["b"] = data.b;
-    json["a"] = data.a;
-}
-
-}
-
-namespace glm {
-
-void to_json(hd::JSON &json, const vec2 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-}
-
-void to_json(hd::JSON &json, const ivec2 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-}
-
-void to_json(hd::JSON &json, const vec3 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-    json["z"] = data.z;
-}
-
-void to_json(hd::JSON &json, const ivec3 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-    json["z"] = data.z;
-}
-
-void to_json(hd::JSON &json, const vec4 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-    json["z"] = data.z;
-    json["w"] = data.w;
-}
-
-void to_json(hd::JSON &json, const ivec4 &data) {
-    json["x"] = data.x;
-    json["y"] = data.y;
-    json["z"] = data.z;
-    json["w"] = data.w;
-}
-
-void from_json(const hd::JSON &json, vec2 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-}
-
-void from_json(const hd::JSON &json, ivec2 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-}
-
-void from_json(const hd::JSON &json, vec3 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-    data.z = json.at("z");
-}
-
-void from_json(const hd::JSON &json, ivec3 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-    data.z = json.at("z");
-}
-
-void from_json(const hd::JSON &json, vec4 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-    data.z = json.at("z");
-    data.w = json.at("w");
-}
-
-void from_json(const hd::JSON &json, ivec4 &data) {
-    data.x = json.at("x");
-    data.y = json.at("y");
-    data.z = json.at("z");
-    data.w = json.at("w");
-}
+template<typename BasicJSON>
+void from_json(const BasicJSON &json, Color4 &data) {
+    if (json.is_number_unsigned()) {
+        uint32_t packed = json.template get<uint32_t>();
+        data = Color4(static_cast<uint8_t>(packed >> 24), static_cast<uint8_t>(packed >> 16), static_cast<uint8_t>(packed >> 8), static_cast<uint8_t>(packed));
+    }
+    else {
+        JSONReflect::fromJSON(json, data);
+    }
+}
+
+template<typename BasicJSON>
+void to_json(BasicJSON &json, const Color4 &data) {
+    if (JSONReflect::isCompactMode()) {
+        json = (static_cast<uint32_t>(data.r) << 24) | (static_cast<uint32_t>(data.g) << 16) | (static_cast<uint32_t>(data.b) << 8) | data.a;
+    }
+    else {
+        JSONReflect::toJSON(json, data);
+    }
+}
+
+template void from_json(const JSON &json, StringHash &data);
+template void to_json(JSON &json, const StringHash &data);
+template void from_json(const JSON &json, Color4 &data);
+template void to_json(JSON &json, const Color4 &data);
+
+template void from_json(const ArenaJSON &json, StringHash &data);
+template void to_json(ArenaJSON &json, const StringHash &data);
+template void from_json(const ArenaJSON &json, Color4 &data);
+template void to_json(ArenaJSON &json, const Color4 &data);
 
 }
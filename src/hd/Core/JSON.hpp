@@ -1,35 +1,74 @@
 #pragma once
 #include "StringHash.hpp"
 #include "Color.hpp"
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "FlatMap.hpp"
+#include "JSONReflect.hpp"
 #include "../../nlohmann/json.hpp"
 #include <glm/glm.hpp>
 
 namespace hd {
 
+class Stream;
+class JSONVisitor;
+
 using JSON = nlohmann::json;
+using JSONSAX = JSON::json_sax_t;
+
+// JSON with FlatMap objects and containers allocated from the current Arena (see ArenaScope), so parsing a large
+// document takes a few block allocations and destroying it frees nothing one by one. Values must be created
+// and modified while the arena is current and destroyed before it is reset. Strings stay std::string, so
+// short ones need no allocation and values convert to std::string as with JSON.
+using ArenaJSON = nlohmann::basic_json<FlatMap, std::vector, std::string, bool, int64_t, uint64_t, double, ArenaAllocator>;
+
+enum class JSONFormat {
+    Auto, // by stream name extension: .cbor, .msgpack/.mpk, anything else is text
+    Text,
+    CBOR,
+    MessagePack
+};
+
+// Binary formats keep the same document model, they only skip number and string parsing and are
+// noticeably smaller, so shipped data can be converted at build time (see tools/JSONConvert)
+class JSONUtils : public StaticClass {
+public:
+    static JSON read(Stream &stream, JSONFormat format = JSONFormat::Auto);
+    // Needs a current Arena
+    static ArenaJSON readArena(Stream &stream, JSONFormat format = JSONFormat::Auto);
+    // indent is only used by the text format, -1 gives the most compact output
+    static void write(Stream &stream, const JSON &json, JSONFormat format = JSONFormat::Auto, int indent = -1);
+    // Stream the document through a fixed size buffer into a handler without building a JSON value, so memory
+    // use does not depend on the document size. Returns false if the handler stopped the parse, errors are
+    // passed to handler.parse_error.
+    static bool parse(Stream &stream, JSONSAX &handler, JSONFormat format = JSONFormat::Auto);
+    static void parse(Stream &stream, JSONVisitor &visitor, JSONFormat format = JSONFormat::Auto);
+    static JSONFormat getFormat(const std::string &path);
+};
+
+// StringHash and Color4 conversions are instantiated for JSON and ArenaJSON
+template<typename BasicJSON>
+void from_json(const BasicJSON &json, StringHash &data);
+template<typename BasicJSON>
+void to_json(BasicJSON &json, const StringHash &data);
 
-void from_json(const JSON &json, StringHash &data);
-void from_json(const JSON &json, Color4 &data);
+HD_REFLECT(Color4, r, g, b, a)
 
-void to_json(JSON &json, const StringHash &data);
-void to_json(JSON &json, const Color4 &data);
+// Color4 is an {r, g, b, a} object, or a 0xRRGGBBAA number in compact mode. Readers also accept [r, g, b, a].
+template<typename BasicJSON>
+void from_json(const BasicJSON &json, Color4 &data);
+template<typename BasicJSON>
+void to_json(BasicJSON &json, const Color4 &data);
 
 }
 
 namespace glm {
 
-void to_json(hd::JSON &json, const vec2 &data);
-void to_json(hd::JSON &json, const ivec2 &data);
-void to_json(hd::JSON &json, const vec3 &data);
-void to_json(hd::JSON &json, const ivec3 &data);
-void to_json(hd::JSON &json, const vec4 &data);
-void to_json(hd::JSON &json, const ivec4 &data);
-
-void from_json(const hd::JSON &json, vec2 &data);
-void from_json(const hd::JSON &json, ivec2 &data);
-void from_json(const hd::JSON &json, vec3 &data);
-void from_json(const hd::JSON &json, ivec3 &data);
-void from_json(const hd::JSON &json, vec4 &data);
-void from_json(const hd::JSON &json, ivec4 &data);
+HD_JSON_REFLECT_COMPACT(vec2, x, y)
+HD_JSON_REFLECT_COMPACT(ivec2, x, y)
+HD_JSON_REFLECT_COMPACT(vec3, x, y, z)
+HD_JSON_REFLECT_COMPACT(ivec3, x, y, z)
+HD_JSON_REFLECT_COMPACT(vec4, x, y, z, w)
+HD_JSON_REFLECT_COMPACT(ivec4, x, y, z, w)
 
 }
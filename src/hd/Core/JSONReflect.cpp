@@ -0,0 +1,48 @@
+#include "JSONReflect.hpp"
+#include "Log.hpp"
+
+namespace hd {
+
+static thread_local bool gIsCompactMode = false;
+
+bool JSONReflect::isCompactMode() {
+    return gIsCompactMode;
+}
+
+void JSONReflect::setCompactMode(bool isCompact) {
+    gIsCompactMode = isCompact;
+}
+
+void JSONReflect::writeBytes(Stream &stream, const void *data, size_t size) {
+    if (size > 0) {
+        HD_ASSERT(stream.write(data, size) == size);
+    }
+}
+
+void JSONReflect::readBytes(Stream &stream, void *data, size_t size) {
+    if (size > 0 && stream.read(data, size) != size) {
+        HD_LOG_FATAL("Failed to read data from stream '{}'. Error: unexpected end of stream", stream.getName().data());
+    }
+}
+
+void JSONReflect::writeCount(Stream &stream, size_t count) {
+    HD_ASSERT(count <= UINT32_MAX);
+    uint32_t value = static_cast<uint32_t>(count);
+    writeBytes(stream, &value, sizeof(value));
+}
+
+size_t JSONReflect::readCount(Stream &stream) {
+    uint32_t value = 0;
+    readBytes(stream, &value, sizeof(value));
+    return value;
+}
+
+JSONCompactScope::JSONCompactScope(bool isCompact) : mPrevious(JSONReflect::isCompactMode()) {
+    JSONReflect::setCompactMode(isCompact);
+}
+
+JSONCompactScope::~JSONCompactScope() {
+    JSONReflect::setCompactMode(mPrevious);
+}
+
+}
@@ -0,0 +1,309 @@
+#pragma once
+#include "Common.hpp"
+#include "StringHash.hpp"
+#include "../IO/Stream.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Declares the serialized fields of a type once. Generates nlohmann to_json/from_json for any basic_json
+// (JSON, ArenaJSON) and makes the type usable with JSONReflect::write/read, a raw binary form.
+// Use it in the namespace of the type, fields are written in the given order:
+//     struct Vertex { glm::vec3 pos; Color4 color; };
+//     HD_JSON_REFLECT(Vertex, pos, color)
+// Readers accept an object with the field names as keys or an array of the field values in order.
+#define HD_JSON_REFLECT(Type, ...) \
+    HD_REFLECT(Type, __VA_ARGS__) \
+    _HD_JSON_REFLECT_FUNCTIONS(Type, false)
+
+// Same, but in compact mode (see JSONCompactScope) the type is written as an array, for small value types
+#define HD_JSON_REFLECT_COMPACT(Type, ...) \
+    HD_REFLECT(Type, __VA_ARGS__) \
+    _HD_JSON_REFLECT_FUNCTIONS(Type, true)
+
+// Only declares the fields, for types with their own JSON conversions that still use JSONReflect
+#define HD_REFLECT(Type, ...) \
+    inline const auto &hdGetReflectedFields(const Type *) { \
+        static const auto fields = std::make_tuple(_HD_REFLECT_EXPAND(HD_CONCAT(_HD_REFLECT_FIELDS_, _HD_REFLECT_COUNT(__VA_ARGS__))(__VA_ARGS__))); \
+        return fields; \
+    }
+
+#define _HD_JSON_REFLECT_FUNCTIONS(Type, isCompactable) \
+    template<typename BasicJSON> \
+    void to_json(BasicJSON &json, const Type &data) { \
+        hd::JSONReflect::toJSON(json, data, isCompactable); \
+    } \
+    template<typename BasicJSON> \
+    void from_json(const BasicJSON &json, Type &data) { \
+        hd::JSONReflect::fromJSON(json, data); \
+    }
+
+#define _HD_REFLECT_EXPAND(x) x
+#define _HD_REFLECT_COUNT(...) _HD_REFLECT_EXPAND(_HD_REFLECT_COUNT_IMPL(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define _HD_REFLECT_COUNT_IMPL(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+// The accessor is a generic lambda rather than a member pointer, so members of anonymous unions and structs
+// (glm vectors, Color4) resolve to the enclosing type
+#define _HD_REFLECT_FIELD(field) hd::details::makeReflectedField(#field, [](auto &object) -> auto & { return object.field; })
+#define _HD_REFLECT_FIELDS_1(f) _HD_REFLECT_FIELD(f)
+#define _HD_REFLECT_FIELDS_2(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_1(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_3(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_2(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_4(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_3(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_5(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_4(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_6(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_5(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_7(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_6(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_8(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_7(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_9(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_8(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_10(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_9(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_11(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_10(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_12(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_11(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_13(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_12(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_14(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_13(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_15(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_14(__VA_ARGS__))
+#define _HD_REFLECT_FIELDS_16(f, ...) _HD_REFLECT_FIELD(f), _HD_REFLECT_EXPAND(_HD_REFLECT_FIELDS_15(__VA_ARGS__))
+
+namespace hd {
+
+namespace details {
+
+template<typename Getter>
+struct ReflectedField {
+    const char *name;
+    uint64_t hash; // same value as StringHash(name), computed without registering the name
+    Getter get;
+};
+
+template<typename Getter>
+ReflectedField<Getter> makeReflectedField(const char *name, Getter get) {
+    // StringHash(const std::string &) adds the name to its global table, which isn't thread safe
+    return { name, static_cast<uint64_t>(std::hash<std::string_view>()(name)), get };
+}
+
+template<typename T, typename = void>
+struct IsReflected : std::false_type {};
+
+template<typename T>
+struct IsReflected<T, std::void_t<decltype(hdGetReflectedFields(std::declval<const T *>()))>> : std::true_type {};
+
+template<typename T>
+struct IsVector : std::false_type {};
+
+template<typename T, typename Allocator>
+struct IsVector<std::vector<T, Allocator>> : std::true_type {};
+
+template<typename T>
+struct AlwaysFalse : std::false_type {};
+
+}
+
+class JSONReflect : public StaticClass {
+public:
+    template<typename T>
+    static constexpr bool isReflected() {
+        return details::IsReflected<T>::value;
+    }
+
+    template<typename T>
+    static const auto &getFields() {
+        return hdGetReflectedFields(static_cast<const T *>(nullptr));
+    }
+
+    template<typename T>
+    static constexpr size_t getFieldCount() {
+        return std::tuple_size<std::decay_t<decltype(getFields<T>())>>::value;
+    }
+
+    // Calls func(field, index) for every field of T
+    template<typename T, typename F>
+    static void forEachField(F &&func) {
+        forEachField(getFields<T>(), func, std::make_index_sequence<getFieldCount<T>()>());
+    }
+
+    // With isCompactable the fields are written as an array while compact mode is on
+    template<typename BasicJSON, typename T>
+    static void toJSON(BasicJSON &json, const T &data, bool isCompactable = false) {
+        if (isCompactable && isCompactMode()) {
+            typename BasicJSON::array_t values;
+            values.reserve(getFieldCount<T>());
+            forEachField<T>([&](const auto &field, size_t) {
+                values.emplace_back(field.get(data));
+            });
+            json = std::move(values);
+        }
+        else {
+            forEachField<T>([&](const auto &field, size_t) {
+                json[field.name] = field.get(data);
+            });
+        }
+    }
+
+    // Objects are matched to fields by key hash in one pass, unknown keys are ignored and missing fields
+    // throw out_of_range like JSON::at. Arrays must hold one value per field.
+    template<typename BasicJSON, typename T>
+    static void fromJSON(const BasicJSON &json, T &data) {
+        constexpr size_t fieldCount = getFieldCount<T>();
+        static_assert(fieldCount <= 64, "Too many reflected fields");
+        if (json.is_array()) {
+            if (json.size() != fieldCount) {
+                throw BasicJSON::type_error::create(302, "type must be array of " + std::to_string(fieldCount) +
+                    " values, but has " + std::to_string(json.size()));
+            }
+            forEachField<T>([&](const auto &field, size_t index) {
+                json[index].get_to(field.get(data));
+            });
+            return;
+        }
+        if (!json.is_object()) {
+            throw BasicJSON::type_error::create(302, std::string("type must be object or array, but is ") + json.type_name());
+        }
+        uint64_t foundMask = 0;
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            uint64_t hash = std::hash<std::string>()(it.key());
+            forEachField<T>([&](const auto &field, size_t index) {
+                // The hash only filters, an unknown key with a colliding hash must not overwrite the field
+                if (field.hash == hash && it.key() == field.name) {
+                    it.value().get_to(field.get(data));
+                    foundMask |= static_cast<uint64_t>(1) << index;
+                }
+            });
+        }
+        if (foundMask != (fieldCount == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << fieldCount) - 1)) {
+            forEachField<T>([&](const auto &field, size_t index) {
+                if (!(foundMask & (static_cast<uint64_t>(1) << index))) {
+                    throw BasicJSON::out_of_range::create(403, std::string("key '") + field.name + "' not found");
+                }
+            });
+        }
+    }
+
+    // Compact mode of the calling thread, see JSONCompactScope
+    static bool isCompactMode();
+    static void setCompactMode(bool isCompact);
+
+    // Binary form: fields in declaration order in native byte order, strings and vectors prefixed with a
+    // 32 bit count. Vectors of arithmetic types, and of reflected types whose fields are arithmetic and
+    // fill the whole struct without padding (e.g. glm vectors), are copied as one block.
+    template<typename T>
+    static void write(Stream &stream, const T &value) {
+        if constexpr (isReflected<T>()) {
+            forEachField<T>([&](const auto &field, size_t) {
+                write(stream, field.get(value));
+            });
+        }
+        else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+            writeBytes(stream, &value, sizeof(T));
+        }
+        else if constexpr (std::is_same<T, StringHash>::value) {
+            write(stream, value.getHash());
+        }
+        else if constexpr (std::is_same<T, std::string>::value) {
+            writeCount(stream, value.size());
+            writeBytes(stream, value.data(), value.size());
+        }
+        else if constexpr (details::IsVector<T>::value) {
+            using Element = typename T::value_type;
+            writeCount(stream, value.size());
+            if (isPacked<Element>()) {
+                writeBytes(stream, value.data(), value.size()*sizeof(Element));
+            }
+            else {
+                for (const auto &element : value) {
+                    write(stream, element);
+                }
+            }
+        }
+        else {
+            static_assert(details::AlwaysFalse<T>::value, "Type is not serializable, declare it with HD_JSON_REFLECT");
+        }
+    }
+
+    template<typename T>
+    static void read(Stream &stream, T &value) {
+        if constexpr (isReflected<T>()) {
+            forEachField<T>([&](const auto &field, size_t) {
+                read(stream, field.get(value));
+            });
+        }
+        else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+            readBytes(stream, &value, sizeof(T));
+        }
+        else if constexpr (std::is_same<T, StringHash>::value) {
+            uint64_t hash;
+            read(stream, hash);
+            value = StringHash(hash);
+        }
+        else if constexpr (std::is_same<T, std::string>::value) {
+            value.resize(readCount(stream));
+            readBytes(stream, value.data(), value.size());
+        }
+        else if constexpr (details::IsVector<T>::value) {
+            using Element = typename T::value_type;
+            value.resize(readCount(stream));
+            if (isPacked<Element>()) {
+                readBytes(stream, value.data(), value.size()*sizeof(Element));
+            }
+            else {
+                for (auto &element : value) {
+                    read(stream, element);
+                }
+            }
+        }
+        else {
+            static_assert(details::AlwaysFalse<T>::value, "Type is not serializable, declare it with HD_JSON_REFLECT");
+        }
+    }
+
+private:
+    template<typename Fields, typename F, size_t... INDICES>
+    static void forEachField(const Fields &fields, F &func, std::index_sequence<INDICES...>) {
+        (func(std::get<INDICES>(fields), INDICES), ...);
+    }
+
+    // Whether the binary form of T is exactly its memory
+    template<typename T>
+    static bool isPacked() {
+        if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+            return true;
+        }
+        else if constexpr (isReflected<T>() && std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value) {
+            static const bool packed = [] {
+                T probe{};
+                size_t offset = 0;
+                bool isContiguous = true;
+                forEachField<T>([&](const auto &field, size_t) {
+                    using Field = std::decay_t<decltype(field.get(probe))>;
+                    const uint8_t *address = reinterpret_cast<const uint8_t *>(&field.get(probe));
+                    isContiguous = isContiguous && isPacked<Field>() &&
+                        address == reinterpret_cast<const uint8_t *>(&probe) + offset;
+                    offset += sizeof(Field);
+                });
+                return isContiguous && offset == sizeof(T);
+            }();
+            return packed;
+        }
+        else {
+            return false;
+        }
+    }
+
+    static void writeBytes(Stream &stream, const void *data, size_t size);
+    static void readBytes(Stream &stream, void *data, size_t size);
+    static void writeCount(Stream &stream, size_t count);
+    static size_t readCount(Stream &stream);
+};
+
+// Turns on compact JSON output of HD_JSON_REFLECT_COMPACT types (glm vectors as arrays, Color4 as packed
+// 0xRRGGBBAA) on this thread for the scope lifetime
+class JSONCompactScope : public Noncopyable, public Nonmovable {
+public:
+    explicit JSONCompactScope(bool isCompact = true);
+    ~JSONCompactScope();
+
+private:
+    bool mPrevious;
+};
+
+}
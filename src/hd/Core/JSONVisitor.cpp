@@ -0,0 +1,115 @@
+#include "JSONVisitor.hpp"
+
+namespace hd {
+
+JSONVisitorSAX::JSONVisitorSAX(JSONVisitor &root) : mStack{ &root }, mSkipDepth(0) {
+}
+
+bool JSONVisitorSAX::null() {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitNull(mKey);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::boolean(bool val) {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitBool(mKey, val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::number_integer(number_integer_t val) {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitInt(mKey, val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::number_unsigned(number_unsigned_t val) {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitUint(mKey, val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::number_float(number_float_t val, const string_t &/*s*/) {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitFloat(mKey, val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::string(string_t &val) {
+    if (JSONVisitor *visitor = getCurrent()) {
+        visitor->visitString(mKey, val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::start_object(size_t /*elements*/) {
+    return startContainer(true);
+}
+
+bool JSONVisitorSAX::key(string_t &val) {
+    if (mSkipDepth == 0) {
+        mKey.swap(val);
+    }
+    return true;
+}
+
+bool JSONVisitorSAX::end_object() {
+    return endContainer();
+}
+
+bool JSONVisitorSAX::start_array(size_t /*elements*/) {
+    return startContainer(false);
+}
+
+bool JSONVisitorSAX::end_array() {
+    return endContainer();
+}
+
+bool JSONVisitorSAX::parse_error(size_t /*position*/, const std::string &/*lastToken*/, const nlohmann::detail::exception &ex) {
+    mError = ex.what();
+    return false;
+}
+
+const std::string &JSONVisitorSAX::getError() const {
+    return mError;
+}
+
+JSONVisitor *JSONVisitorSAX::getCurrent() const {
+    return mSkipDepth == 0 ? mStack.back() : nullptr;
+}
+
+bool JSONVisitorSAX::startContainer(bool isObject) {
+    JSONVisitor *visitor = getCurrent();
+    JSONVisitor *child = nullptr;
+    if (visitor) {
+        child = isObject ? visitor->visitObject(mKey) : visitor->visitArray(mKey);
+    }
+    if (child) {
+        mStack.push_back(child);
+    }
+    else {
+        mSkipDepth++;
+    }
+    // Array elements have no key
+    mKey.clear();
+    return true;
+}
+
+bool JSONVisitorSAX::endContainer() {
+    if (mSkipDepth > 0) {
+        mSkipDepth--;
+    }
+    else {
+        mStack.back()->end();
+        mStack.pop_back();
+    }
+    mKey.clear();
+    return true;
+}
+
+}
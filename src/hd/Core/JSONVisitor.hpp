@@ -0,0 +1,61 @@
+#pragma once
+#include "JSON.hpp"
+#include <vector>
+
+namespace hd {
+
+// Typed callbacks for streaming parses, see JSONUtils::parse. Each visitor receives the members of one object
+// or the elements of one array (with an empty key) and decides which visitor handles each nested container,
+// so structs are filled while parsing without building a document. Unhandled values are ignored.
+class JSONVisitor {
+public:
+    virtual ~JSONVisitor() = default;
+
+    virtual void visitNull(const std::string &/*key*/) {}
+    virtual void visitBool(const std::string &/*key*/, bool /*value*/) {}
+    virtual void visitInt(const std::string &/*key*/, int64_t /*value*/) {}
+    virtual void visitUint(const std::string &key, uint64_t value) { visitInt(key, static_cast<int64_t>(value)); }
+    virtual void visitFloat(const std::string &/*key*/, double /*value*/) {}
+    // value can be moved from
+    virtual void visitString(const std::string &/*key*/, std::string &/*value*/) {}
+    // Visitor for the members of a nested object or elements of a nested array, nullptr skips the whole value.
+    // The returned visitor must stay alive until its end() is called.
+    virtual JSONVisitor *visitObject(const std::string &/*key*/) { return nullptr; }
+    virtual JSONVisitor *visitArray(const std::string &/*key*/) { return nullptr; }
+    // Called on the visitor returned by visitObject/visitArray once the container is closed
+    virtual void end() {}
+};
+
+// Adapts a JSONVisitor to the nlohmann SAX interface. The document itself is passed to the root visitor
+// as a value with an empty key, e.g. a document that is an object goes to root.visitObject("").
+class JSONVisitorSAX : public JSON::json_sax_t {
+public:
+    explicit JSONVisitorSAX(JSONVisitor &root);
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t &s) override;
+    bool string(string_t &val) override;
+    bool start_object(size_t elements) override;
+    bool key(string_t &val) override;
+    bool end_object() override;
+    bool start_array(size_t elements) override;
+    bool end_array() override;
+    bool parse_error(size_t position, const std::string &lastToken, const nlohmann::detail::exception &ex) override;
+
+    const std::string &getError() const;
+
+private:
+    JSONVisitor *getCurrent() const;
+    bool startContainer(bool isObject);
+    bool endContainer();
+
+    std::vector<JSONVisitor *> mStack;
+    size_t mSkipDepth; // open containers below a skipped value
+    std::string mKey;
+    std::string mError;
+};
+
+}
@@ -0,0 +1,398 @@
+#include "LazyJSON.hpp"
+#include "Log.hpp"
+#include "../IO/Stream.hpp"
+#include "../Math/MathUtils.hpp"
+#include <cstring>
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+static const size_t BLOCK_SIZE = 64;
+
+static bool isWhitespace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+// Bit i of each mask is set if byte i of the block is a backslash, a quote or one of {}[]:,
+static void getBlockMasks(const uint8_t *block, uint64_t &backslash, uint64_t &quote, uint64_t &structural) {
+#if defined(HD_SIMD_AVX2)
+    const __m256i backslashChar = _mm256_set1_epi8('\\');
+    const __m256i quoteChar = _mm256_set1_epi8('"');
+    const __m256i lowerBit = _mm256_set1_epi8(0x20);
+    // '[' and ']' are '{' and '}' without bit 0x20
+    const __m256i openChar = _mm256_set1_epi8('{');
+    const __m256i closeChar = _mm256_set1_epi8('}');
+    const __m256i colonChar = _mm256_set1_epi8(':');
+    const __m256i commaChar = _mm256_set1_epi8(',');
+    backslash = quote = structural = 0;
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i*32));
+        __m256i lower = _mm256_or_si256(v, lowerBit);
+        __m256i s = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, openChar), _mm256_cmpeq_epi8(lower, closeChar)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colonChar), _mm256_cmpeq_epi8(v, commaChar)));
+        int shift = i*32;
+        backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslashChar)))) << shift;
+        quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quoteChar)))) << shift;
+        structural |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(s))) << shift;
+    }
+#elif defined(HD_SIMD_SSE2)
+    const __m128i backslashChar = _mm_set1_epi8('\\');
+    const __m128i quoteChar = _mm_set1_epi8('"');
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i openChar = _mm_set1_epi8('{');
+    const __m128i closeChar = _mm_set1_epi8('}');
+    const __m128i colonChar = _mm_set1_epi8(':');
+    const __m128i commaChar = _mm_set1_epi8(',');
+    backslash = quote = structural = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i*16));
+        __m128i lower = _mm_or_si128(v, lowerBit);
+        __m128i s = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, openChar), _mm_cmpeq_epi8(lower, closeChar)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, colonChar), _mm_cmpeq_epi8(v, commaChar)));
+        int shift = i*16;
+        backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslashChar))) << shift;
+        quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quoteChar))) << shift;
+        structural |= static_cast<uint64_t>(_mm_movemask_epi8(s)) << shift;
+    }
+#else
+    backslash = quote = structural = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        uint8_t ch = block[i];
+        uint64_t bit = static_cast<uint64_t>(1) << i;
+        if (ch == '\\') {
+            backslash |= bit;
+        }
+        else if (ch == '"') {
+            quote |= bit;
+        }
+        else if (ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' || ch == ',') {
+            structural |= bit;
+        }
+    }
+#endif
+}
+
+// Characters escaped by an odd run of backslashes, prevEscaped carries a run that crosses blocks
+static uint64_t findEscaped(uint64_t backslash, uint64_t &prevEscaped) {
+    const uint64_t EVEN_BITS = 0x5555555555555555ULL;
+    backslash &= ~prevEscaped;
+    uint64_t followsEscape = (backslash << 1) | prevEscaped;
+    // Adding a run's first bit to the run carries past its end, the carry lands on an even or odd bit
+    // depending on the run length, which tells which characters are escaped
+    uint64_t oddSequenceStarts = backslash & ~EVEN_BITS & ~followsEscape;
+    uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+    prevEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+    uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+    return (EVEN_BITS ^ invertMask) & followsEscape;
+}
+
+// Bit i is the xor of bits 0..i, i.e. set between an opening quote (inclusive) and a closing one
+static uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+LazyJSONValue::LazyJSONValue() : mDocument(nullptr), mBegin(0), mEnd(0), mStructural(0) {
+}
+
+LazyJSONValue::LazyJSONValue(const LazyJSON *document, size_t begin, size_t end, size_t structural) :
+    mDocument(document), mBegin(begin), mEnd(end), mStructural(structural) {
+}
+
+bool LazyJSONValue::isValid() const {
+    return mDocument != nullptr;
+}
+
+LazyJSONType LazyJSONValue::getType() const {
+    if (!mDocument || mBegin == mEnd) {
+        return LazyJSONType::Invalid;
+    }
+    switch (mDocument->mText[mBegin]) {
+        case '{': {
+            return LazyJSONType::Object;
+        }
+        case '[': {
+            return LazyJSONType::Array;
+        }
+        case '"': {
+            return LazyJSONType::String;
+        }
+        case 't':
+        case 'f': {
+            return LazyJSONType::Bool;
+        }
+        case 'n': {
+            return LazyJSONType::Null;
+        }
+        default: {
+            return LazyJSONType::Number;
+        }
+    }
+}
+
+bool LazyJSONValue::isObject() const {
+    return mDocument && mDocument->mText[mBegin] == '{';
+}
+
+bool LazyJSONValue::isArray() const {
+    return mDocument && mDocument->mText[mBegin] == '[';
+}
+
+LazyJSONValue LazyJSONValue::find(std::string_view key) const {
+    if (!isObject()) {
+        return LazyJSONValue();
+    }
+    const std::string &text = mDocument->mText;
+    const auto &structurals = mDocument->mStructurals;
+    size_t index = mStructural + 1;
+    while (text[structurals[index]] == ':') {
+        LazyJSONValue value = getValueAfter(index);
+        if (isKeyEqual(getMemberKey(index), key)) {
+            return value;
+        }
+        index = value.getNextStructural();
+        if (text[structurals[index]] != ',') {
+            break;
+        }
+        index++;
+    }
+    return LazyJSONValue();
+}
+
+bool LazyJSONValue::contains(std::string_view key) const {
+    return find(key).isValid();
+}
+
+LazyJSONValue LazyJSONValue::operator[](std::string_view key) const {
+    return find(key);
+}
+
+LazyJSONValue LazyJSONValue::at(size_t index) const {
+    if (!isArray() || empty()) {
+        return LazyJSONValue();
+    }
+    const auto &structurals = mDocument->mStructurals;
+    size_t separator = mStructural;
+    while (true) {
+        LazyJSONValue value = getValueAfter(separator);
+        if (index-- == 0) {
+            return value;
+        }
+        separator = value.getNextStructural();
+        if (mDocument->mText[structurals[separator]] != ',') {
+            return LazyJSONValue();
+        }
+    }
+}
+
+LazyJSONValue LazyJSONValue::operator[](size_t index) const {
+    return at(index);
+}
+
+bool LazyJSONValue::empty() const {
+    if (!isObject() && !isArray()) {
+        return true;
+    }
+    // The closing bracket right after the opening one, '[1]' has no structurals in between either
+    return mDocument->mMatches[mStructural] == mStructural + 1 &&
+        mDocument->mStructurals[mStructural + 1] == mDocument->skipWhitespace(mBegin + 1);
+}
+
+size_t LazyJSONValue::size() const {
+    size_t count = 0;
+    if (isObject()) {
+        forEachMember([&](std::string_view, const LazyJSONValue &) {
+            count++;
+        });
+    }
+    else {
+        forEachElement([&](const LazyJSONValue &) {
+            count++;
+        });
+    }
+    return count;
+}
+
+std::string_view LazyJSONValue::getText() const {
+    if (!mDocument) {
+        return std::string_view();
+    }
+    return std::string_view(mDocument->mText.data() + mBegin, mEnd - mBegin);
+}
+
+JSON LazyJSONValue::parse() const {
+    if (!mDocument) {
+        return JSON();
+    }
+    const char *text = mDocument->mText.data();
+    return JSON::parse(text + mBegin, text + mEnd);
+}
+
+LazyJSONValue LazyJSONValue::getValueAfter(size_t separator) const {
+    const std::string &text = mDocument->mText;
+    const auto &structurals = mDocument->mStructurals;
+    size_t begin = mDocument->skipWhitespace(structurals[separator] + 1);
+    size_t next = separator + 1;
+    if (text[begin] == '{' || text[begin] == '[') {
+        return LazyJSONValue(mDocument, begin, structurals[mDocument->mMatches[next]] + 1, next);
+    }
+    size_t end = structurals[next];
+    while (end > begin && isWhitespace(text[end - 1])) {
+        end--;
+    }
+    return LazyJSONValue(mDocument, begin, end, next);
+}
+
+size_t LazyJSONValue::getNextStructural() const {
+    if (isObject() || isArray()) {
+        return mDocument->mMatches[mStructural] + 1;
+    }
+    return mStructural;
+}
+
+std::string_view LazyJSONValue::getMemberKey(size_t colon) const {
+    const std::string &text = mDocument->mText;
+    const auto &structurals = mDocument->mStructurals;
+    size_t begin = mDocument->skipWhitespace(structurals[colon - 1] + 1);
+    size_t end = structurals[colon];
+    while (end > begin && isWhitespace(text[end - 1])) {
+        end--;
+    }
+    // Without the quotes
+    if (end - begin >= 2) {
+        begin++;
+        end--;
+    }
+    return std::string_view(text.data() + begin, end - begin);
+}
+
+bool LazyJSONValue::isKeyEqual(std::string_view rawKey, std::string_view key) {
+    if (rawKey.find('\\') == std::string_view::npos) {
+        return rawKey == key;
+    }
+    std::string quoted;
+    quoted.reserve(rawKey.size() + 2);
+    quoted += '"';
+    quoted += rawKey;
+    quoted += '"';
+    return JSON::parse(quoted).get_ref<const std::string &>() == key;
+}
+
+LazyJSON::LazyJSON() {
+}
+
+LazyJSON::LazyJSON(std::string &&text) {
+    create(std::move(text));
+}
+
+LazyJSON::~LazyJSON() {
+    destroy();
+}
+
+void LazyJSON::create(std::string &&text) {
+    destroy();
+    mText = std::move(text);
+    if (!buildIndex()) {
+        HD_LOG_FATAL("Failed to index JSON text. Error: unbalanced brackets or unterminated string");
+    }
+}
+
+void LazyJSON::create(Stream &stream) {
+    destroy();
+    mText = stream.readAllText();
+    if (!buildIndex()) {
+        HD_LOG_FATAL("Failed to load JSON from stream '{}'. Error: unbalanced brackets or unterminated string", stream.getName().data());
+    }
+}
+
+void LazyJSON::destroy() {
+    mText.clear();
+    mStructurals.clear();
+    mMatches.clear();
+}
+
+LazyJSONValue LazyJSON::getRoot() const {
+    size_t begin = skipWhitespace(0);
+    if (begin < mText.size() && (mText[begin] == '{' || mText[begin] == '[')) {
+        return LazyJSONValue(this, begin, mStructurals[mMatches[0]] + 1, 0);
+    }
+    size_t end = mText.size();
+    while (end > begin && isWhitespace(mText[end - 1])) {
+        end--;
+    }
+    return LazyJSONValue(this, begin, end, mStructurals.size() - 1);
+}
+
+const std::string &LazyJSON::getText() const {
+    return mText;
+}
+
+bool LazyJSON::buildIndex() {
+    HD_ASSERT(mText.size() < UINT32_MAX);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(mText.data());
+    size_t size = mText.size();
+    mStructurals.reserve(size / 8);
+
+    uint64_t prevEscaped = 0, prevInString = 0;
+    for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+        uint64_t backslash, quote, structural;
+        if (offset + BLOCK_SIZE <= size) {
+            getBlockMasks(data + offset, backslash, quote, structural);
+        }
+        else {
+            uint8_t block[BLOCK_SIZE];
+            std::memset(block, ' ', BLOCK_SIZE);
+            std::memcpy(block, data + offset, size - offset);
+            getBlockMasks(block, backslash, quote, structural);
+        }
+        uint64_t quotes = quote & ~findEscaped(backslash, prevEscaped);
+        uint64_t inString = prefixXor(quotes) ^ prevInString;
+        prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+        structural &= ~inString;
+        while (structural) {
+            mStructurals.push_back(static_cast<uint32_t>(offset + MathUtils::countTrailingZeros(structural)));
+            structural &= structural - 1;
+        }
+    }
+    // Sentinel at the terminating zero, so lookups past the last value stop without bounds checks
+    mStructurals.push_back(static_cast<uint32_t>(size));
+    if (prevInString) {
+        return false;
+    }
+
+    mMatches.assign(mStructurals.size(), 0);
+    std::vector<uint32_t> stack;
+    for (size_t i = 0; i + 1 < mStructurals.size(); i++) {
+        char ch = mText[mStructurals[i]];
+        if (ch == '{' || ch == '[') {
+            stack.push_back(static_cast<uint32_t>(i));
+        }
+        else if (ch == '}' || ch == ']') {
+            if (stack.empty() || mText[mStructurals[stack.back()]] != (ch == '}' ? '{' : '[')) {
+                return false;
+            }
+            mMatches[stack.back()] = static_cast<uint32_t>(i);
+            stack.pop_back();
+        }
+    }
+    return stack.empty();
+}
+
+size_t LazyJSON::skipWhitespace(size_t pos) const {
+    while (pos < mText.size() && isWhitespace(mText[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "JSON.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hd {
+
+class LazyJSON;
+
+enum class LazyJSONType {
+    Invalid,
+    Null,
+    Bool,
+    Number,
+    String,
+    Object,
+    Array
+};
+
+// Cheap handle to a value of a LazyJSON, valid while the document lives. Lookups walk the structural index
+// and skip nested containers in one step, nothing is parsed until parse() or get() is called.
+class LazyJSONValue {
+public:
+    LazyJSONValue();
+
+    bool isValid() const;
+    LazyJSONType getType() const;
+    bool isObject() const;
+    bool isArray() const;
+
+    // Member of an object, invalid if this is not an object or has no such key
+    LazyJSONValue find(std::string_view key) const;
+    bool contains(std::string_view key) const;
+    LazyJSONValue operator[](std::string_view key) const;
+    // Element of an array, invalid if out of range
+    LazyJSONValue at(size_t index) const;
+    LazyJSONValue operator[](size_t index) const;
+    // Number of members or elements, 0 for other types
+    size_t size() const;
+    bool empty() const;
+
+    // Calls func(key, value) for every member of an object, key is the raw text without quotes
+    template<typename F>
+    void forEachMember(F &&func) const;
+    // Calls func(value) for every element of an array
+    template<typename F>
+    void forEachElement(F &&func) const;
+
+    // Source text of the value
+    std::string_view getText() const;
+    // Parses just this value
+    JSON parse() const;
+
+    template<typename T>
+    T get() const {
+        return parse().get<T>();
+    }
+
+private:
+    friend class LazyJSON;
+
+    LazyJSONValue(const LazyJSON *document, size_t begin, size_t end, size_t structural);
+
+    // Value that starts after the structural character at index separator
+    LazyJSONValue getValueAfter(size_t separator) const;
+    // Index of the structural that follows the value, i.e. ',' or the closing bracket
+    size_t getNextStructural() const;
+    std::string_view getMemberKey(size_t colon) const;
+    static bool isKeyEqual(std::string_view rawKey, std::string_view key);
+
+    const LazyJSON *mDocument;
+    size_t mBegin, mEnd; // text range
+    size_t mStructural;  // index of the opening bracket for containers, of the structural after the value otherwise
+};
+
+// Indexed JSON document for big files of which only small parts are used. create() runs a single SIMD pass
+// over the text (the structural scan of Langdale and Lemire, "Parsing Gigabytes of JSON per Second"),
+// recording the offsets of {}[]:, outside of strings and matching brackets. Values are parsed on access.
+// Syntax errors outside the parsed values are not detected.
+class LazyJSON : public Noncopyable {
+public:
+    LazyJSON();
+    explicit LazyJSON(std::string &&text);
+    ~LazyJSON();
+
+    void create(std::string &&text);
+    void create(Stream &stream);
+    void destroy();
+
+    LazyJSONValue getRoot() const;
+    const std::string &getText() const;
+
+private:
+    friend class LazyJSONValue;
+
+    bool buildIndex();
+    size_t skipWhitespace(size_t pos) const;
+
+    std::string mText;
+    std::vector<uint32_t> mStructurals; // text offsets
+    std::vector<uint32_t> mMatches;     // for opening brackets the structural index of the closing one
+};
+
+template<typename F>
+void LazyJSONValue::forEachMember(F &&func) const {
+    if (!isObject()) {
+        return;
+    }
+    const auto &structurals = mDocument->mStructurals;
+    size_t index = mStructural + 1;
+    while (mDocument->mText[structurals[index]] == ':') {
+        LazyJSONValue value = getValueAfter(index);
+        func(getMemberKey(index), value);
+        index = value.getNextStructural();
+        if (mDocument->mText[structurals[index]] != ',') {
+            break;
+        }
+        index++;
+    }
+}
+
+template<typename F>
+void LazyJSONValue::forEachElement(F &&func) const {
+    if (!isArray() || empty()) {
+        return;
+    }
+    const auto &structurals = mDocument->mStructurals;
+    size_t separator = mStructural;
+    while (true) {
+        LazyJSONValue value = getValueAfter(separator);
+        func(value);
+        separator = value.getNextStructural();
+        if (mDocument->mText[structurals[separator]] != ',') {
+            break;
+        }
+    }
+}
+
+}
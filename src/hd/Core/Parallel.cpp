@@ -0,0 +1,155 @@
+#include "Parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hd {
+
+struct ParallelJob {
+    const ParallelRangeFunc *func;
+    size_t begin, end, chunkSize, chunkCount;
+    std::atomic<size_t> nextChunk;
+    std::atomic<size_t> doneChunks;
+};
+
+static thread_local bool gIsInsideJob = false;
+
+class WorkerPool : public Singleton<WorkerPool> {
+public:
+    WorkerPool() {
+        mJob = nullptr;
+        mGeneration = 0;
+        mActiveWorkers = 0;
+        mIsStopping = false;
+
+        size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        for (size_t i = 1; i < threadCount; i++) {
+            mWorkers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsStopping = true;
+        }
+        mWorkCondition.notify_all();
+        for (auto &worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    bool run(ParallelJob &job) {
+        std::unique_lock<std::mutex> submitLock(mSubmitMutex, std::try_to_lock);
+        if (!submitLock.owns_lock()) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJob = &job;
+            mGeneration++;
+        }
+        mWorkCondition.notify_all();
+        runChunks(job);
+
+        // The job lives on the caller's stack, wait until no worker references it anymore
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [&]() { return job.doneChunks == job.chunkCount && mActiveWorkers == 0; });
+        mJob = nullptr;
+        return true;
+    }
+
+    size_t getThreadCount() const {
+        return mWorkers.size() + 1;
+    }
+
+private:
+    static void runChunks(ParallelJob &job) {
+        bool wasInsideJob = gIsInsideJob;
+        gIsInsideJob = true;
+        for (size_t chunk = job.nextChunk++; chunk < job.chunkCount; chunk = job.nextChunk++) {
+            size_t chunkBegin = job.begin + chunk*job.chunkSize;
+            size_t chunkEnd = std::min(chunkBegin + job.chunkSize, job.end);
+            (*job.func)(chunkBegin, chunkEnd);
+            job.doneChunks++;
+        }
+        gIsInsideJob = wasInsideJob;
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            ParallelJob *job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkCondition.wait(lock, [&]() { return mIsStopping || mGeneration != seenGeneration; });
+                if (mIsStopping) {
+                    return;
+                }
+                seenGeneration = mGeneration;
+                job = mJob;
+                if (!job) {
+                    continue;
+                }
+                mActiveWorkers++;
+            }
+
+            runChunks(*job);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mActiveWorkers--;
+            }
+            mDoneCondition.notify_all();
+        }
+    }
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mSubmitMutex;
+    std::mutex mMutex;
+    std::condition_variable mWorkCondition;
+    std::condition_variable mDoneCondition;
+    ParallelJob *mJob;
+    uint64_t mGeneration;
+    size_t mActiveWorkers;
+    bool mIsStopping;
+};
+
+void Parallel::forRange(size_t begin, size_t end, size_t minChunkSize, const ParallelRangeFunc &func) {
+    if (begin >= end) {
+        return;
+    }
+
+    size_t count = end - begin;
+    minChunkSize = std::max(minChunkSize, static_cast<size_t>(1));
+    if (count <= minChunkSize || gIsInsideJob) {
+        func(begin, end);
+        return;
+    }
+
+    // A few chunks per thread keep the load balanced when chunks take different time
+    WorkerPool &pool = WorkerPool::get();
+    size_t chunkSize = std::max(minChunkSize, (count + pool.getThreadCount()*4 - 1) / (pool.getThreadCount()*4));
+
+    ParallelJob job;
+    job.func = &func;
+    job.begin = begin;
+    job.end = end;
+    job.chunkSize = chunkSize;
+    job.chunkCount = (count + chunkSize - 1) / chunkSize;
+    job.nextChunk = 0;
+    job.doneChunks = 0;
+    if (job.chunkCount == 1 || !pool.run(job)) {
+        func(begin, end);
+    }
+}
+
+size_t Parallel::getThreadCount() {
+    return WorkerPool::get().getThreadCount();
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "Common.hpp"
+#include <functional>
+
+namespace hd {
+
+using ParallelRangeFunc = std::function<void(size_t begin, size_t end)>;
+
+// Runs loops over index ranges on a shared pool of worker threads, the calling thread takes part in the work.
+// Nested calls, or calls made while the pool is busy with another range, run on the calling thread.
+class Parallel : public StaticClass {
+public:
+    // Splits [begin, end) into chunks of at least minChunkSize indices and blocks until all of them are processed
+    static void forRange(size_t begin, size_t end, size_t minChunkSize, const ParallelRangeFunc &func);
+    static size_t getThreadCount();
+};
+
+}
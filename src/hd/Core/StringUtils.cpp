@@ -1,68 +1,363 @@
 #include "StringUtils.hpp"
+#include "../Math/MathUtils.hpp"
 #include <algorithm>
+#include <charconv>
 #include <locale>
 #include <codecvt>
 #include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+#   include <immintrin.h>
+#endif
 
 namespace hd {
 
-std::vector<std::string> StringUtils::split(const std::string &str, const std::string &separatorsList, bool saveSeparators) {
-    std::vector<std::string> tokens;
-    std::string token;
-    for (const auto &it : str) {
-        if (containsSymbol(separatorsList, it, false)) {
-            tokens.push_back(token);
-            token.clear();
-            if (saveSeparators) {
-                token += it;
-                tokens.push_back(token);
-                token.clear();
+// More symbols than this are looked up in the table byte by byte, comparing against each of them costs more
+static const size_t MAX_SIMD_SYMBOLS = 8;
+
+// Bit per byte value, plus the distinct symbols for SIMD matching
+struct SymbolTable {
+    uint64_t bits[4] = {};
+    uint8_t symbols[MAX_SIMD_SYMBOLS] = {};
+    size_t symbolCount = 0;
+};
+
+static bool hasSymbol(const SymbolTable &table, uint8_t ch) {
+    return (table.bits[ch >> 6] >> (ch & 63)) & 1;
+}
+
+static void addSymbol(SymbolTable &table, uint8_t ch) {
+    if (hasSymbol(table, ch)) {
+        return;
+    }
+    table.bits[ch >> 6] |= static_cast<uint64_t>(1) << (ch & 63);
+    if (table.symbolCount < MAX_SIMD_SYMBOLS) {
+        table.symbols[table.symbolCount] = ch;
+    }
+    table.symbolCount++;
+}
+
+static void initSymbolTable(SymbolTable &table, std::string_view symbolsList, bool caseSensitive) {
+    for (char ch : symbolsList) {
+        addSymbol(table, static_cast<uint8_t>(ch));
+        if (!caseSensitive) {
+            addSymbol(table, static_cast<uint8_t>(StringUtils::toLower(ch)));
+            addSymbol(table, static_cast<uint8_t>(StringUtils::toUpper(ch)));
+        }
+    }
+}
+
+// ASCII case folding tables indexed by byte value
+struct CaseTable {
+    uint8_t lower[256];
+    uint8_t upper[256];
+};
+
+static constexpr CaseTable makeCaseTable() {
+    CaseTable table = {};
+    for (int i = 0; i < 256; i++) {
+        table.lower[i] = static_cast<uint8_t>(i >= 'A' && i <= 'Z' ? i + ('a' - 'A') : i);
+        table.upper[i] = static_cast<uint8_t>(i >= 'a' && i <= 'z' ? i - ('a' - 'A') : i);
+    }
+    return table;
+}
+
+static constexpr CaseTable CASE_TABLE = makeCaseTable();
+
+static uint8_t lowerAscii(char ch) {
+    return CASE_TABLE.lower[static_cast<uint8_t>(ch)];
+}
+
+#if defined(HD_SIMD_AVX2)
+// Sets bit 0x20 of the bytes in 'A'..'Z', the range check is a signed compare after moving 'A' to -128
+static __m256i lowerAscii(__m256i v) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(128 - 'A')));
+    __m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+    return _mm256_or_si256(v, _mm256_and_si256(isUpper, _mm256_set1_epi8(0x20)));
+}
+#elif defined(HD_SIMD_SSE2)
+static __m128i lowerAscii(__m128i v) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 'A')));
+    __m128i isUpper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+    return _mm_or_si128(v, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+static bool equalsIgnoreCase(const char *str1, const char *str2, size_t size) {
+    size_t i = 0;
+#if defined(HD_SIMD_AVX2)
+    for (; i + 32 <= size; i += 32) {
+        __m256i v1 = lowerAscii(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(str1 + i)));
+        __m256i v2 = lowerAscii(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(str2 + i)));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2)) != -1) {
+            return false;
+        }
+    }
+#elif defined(HD_SIMD_SSE2)
+    for (; i + 16 <= size; i += 16) {
+        __m128i v1 = lowerAscii(_mm_loadu_si128(reinterpret_cast<const __m128i *>(str1 + i)));
+        __m128i v2 = lowerAscii(_mm_loadu_si128(reinterpret_cast<const __m128i *>(str2 + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (lowerAscii(str1[i]) != lowerAscii(str2[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Blocks are filtered by the first and the last character of findStr in both cases,
+// only the positions where both match are compared in full
+static size_t findIgnoreCase(std::string_view str, std::string_view findStr) {
+    if (findStr.empty()) {
+        return 0;
+    }
+    if (str.size() < findStr.size()) {
+        return std::string_view::npos;
+    }
+    size_t last = findStr.size() - 1;
+    size_t end = str.size() - last;
+    size_t pos = 0;
+#if defined(HD_SIMD_AVX2)
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(lowerAscii(findStr.front())));
+    const __m256i lastChar = _mm256_set1_epi8(static_cast<char>(lowerAscii(findStr.back())));
+    for (; pos + 32 <= end; pos += 32) {
+        __m256i v1 = lowerAscii(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(str.data() + pos)));
+        __m256i v2 = lowerAscii(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(str.data() + pos + last)));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v1, first), _mm256_cmpeq_epi8(v2, lastChar))));
+        while (mask != 0) {
+            size_t candidate = pos + MathUtils::countTrailingZeros(mask);
+            if (equalsIgnoreCase(str.data() + candidate, findStr.data(), findStr.size())) {
+                return candidate;
             }
+            mask &= mask - 1;
         }
-        else {
-            token += it;
+    }
+#elif defined(HD_SIMD_SSE2)
+    const __m128i first = _mm_set1_epi8(static_cast<char>(lowerAscii(findStr.front())));
+    const __m128i lastChar = _mm_set1_epi8(static_cast<char>(lowerAscii(findStr.back())));
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i v1 = lowerAscii(_mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + pos)));
+        __m128i v2 = lowerAscii(_mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + pos + last)));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v1, first), _mm_cmpeq_epi8(v2, lastChar))));
+        while (mask != 0) {
+            size_t candidate = pos + MathUtils::countTrailingZeros(mask);
+            if (equalsIgnoreCase(str.data() + candidate, findStr.data(), findStr.size())) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; pos < end; pos++) {
+        if (equalsIgnoreCase(str.data() + pos, findStr.data(), findStr.size())) {
+            return pos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+template<typename T>
+static std::optional<T> parseNumber(std::string_view str) {
+    T value;
+    const char *end = str.data() + str.size();
+    std::from_chars_result result = std::from_chars(str.data(), end, value);
+    if (result.ec != std::errc() || result.ptr != end) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Accepts what std::sto* do: leading whitespace, a '+' sign and trailing characters after the number.
+// Unsigned types also take a '-' sign and wrap around like strtoull, e.g. "-1" is the maximum value.
+template<typename T>
+static T toNumber(std::string_view str, const char *funcName) {
+    size_t begin = str.find_first_not_of(" \t\n\r\f\v");
+    bool hasPlus = begin != std::string_view::npos && str[begin] == '+';
+    bool isNegated = std::is_unsigned_v<T> && begin != std::string_view::npos && str[begin] == '-';
+    if (hasPlus || isNegated) {
+        begin++;
+    }
+    if (begin >= str.size() || ((hasPlus || isNegated) && str[begin] == '-')) {
+        throw std::invalid_argument(funcName);
+    }
+    T value;
+    std::from_chars_result result = std::from_chars(str.data() + begin, str.data() + str.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::out_of_range(funcName);
+    }
+    if (result.ec != std::errc()) {
+        throw std::invalid_argument(funcName);
+    }
+    if constexpr (std::is_unsigned_v<T>) {
+        if (isNegated) {
+            value = static_cast<T>(T(0) - value);
+        }
+    }
+    return value;
+}
+
+static bool isArraySeparator(char ch) {
+    return ch == ' ' || ch == ',' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+template<typename T>
+static bool parseNumberArray(std::string_view str, std::vector<T> &values) {
+    const char *ptr = str.data();
+    const char *end = ptr + str.size();
+    while (true) {
+        while (ptr != end && isArraySeparator(*ptr)) {
+            ptr++;
+        }
+        if (ptr == end) {
+            return true;
+        }
+        T value;
+        std::from_chars_result result = std::from_chars(ptr, end, value);
+        if (result.ec != std::errc() || (result.ptr != end && !isArraySeparator(*result.ptr))) {
+            return false;
+        }
+        values.push_back(value);
+        ptr = result.ptr;
+    }
+}
+
+std::vector<std::string> StringUtils::split(std::string_view str, std::string_view separatorsList, bool saveSeparators) {
+    std::vector<std::string_view> views;
+    splitView(str, separatorsList, saveSeparators, views);
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+size_t StringUtils::splitView(std::string_view str, std::string_view separatorsList, bool saveSeparators, std::vector<std::string_view> &tokens) {
+    SymbolTable table;
+    initSymbolTable(table, separatorsList, false);
+    size_t count = tokens.size();
+    size_t tokenBegin = 0;
+    auto addTokens = [&](size_t separator) {
+        tokens.push_back(str.substr(tokenBegin, separator - tokenBegin));
+        if (saveSeparators) {
+            tokens.push_back(str.substr(separator, 1));
+        }
+        tokenBegin = separator + 1;
+    };
+
+    size_t pos = 0;
+#if defined(HD_SIMD_AVX2)
+    if (table.symbolCount > 0 && table.symbolCount <= MAX_SIMD_SYMBOLS) {
+        __m256i symbols[MAX_SIMD_SYMBOLS];
+        for (size_t i = 0; i < table.symbolCount; i++) {
+            symbols[i] = _mm256_set1_epi8(static_cast<char>(table.symbols[i]));
+        }
+        for (; pos + 32 <= str.size(); pos += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str.data() + pos));
+            __m256i matches = _mm256_cmpeq_epi8(v, symbols[0]);
+            for (size_t i = 1; i < table.symbolCount; i++) {
+                matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, symbols[i]));
+            }
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+            while (mask != 0) {
+                addTokens(pos + MathUtils::countTrailingZeros(mask));
+                mask &= mask - 1;
+            }
+        }
+    }
+#elif defined(HD_SIMD_SSE2)
+    if (table.symbolCount > 0 && table.symbolCount <= MAX_SIMD_SYMBOLS) {
+        __m128i symbols[MAX_SIMD_SYMBOLS];
+        for (size_t i = 0; i < table.symbolCount; i++) {
+            symbols[i] = _mm_set1_epi8(static_cast<char>(table.symbols[i]));
+        }
+        for (; pos + 16 <= str.size(); pos += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + pos));
+            __m128i matches = _mm_cmpeq_epi8(v, symbols[0]);
+            for (size_t i = 1; i < table.symbolCount; i++) {
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, symbols[i]));
+            }
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+            while (mask != 0) {
+                addTokens(pos + MathUtils::countTrailingZeros(mask));
+                mask &= mask - 1;
+            }
         }
     }
-    if (!token.empty()) {
-        tokens.push_back(token);
+#endif
+    for (; pos < str.size(); pos++) {
+        if (hasSymbol(table, static_cast<uint8_t>(str[pos]))) {
+            addTokens(pos);
+        }
     }
+    if (tokenBegin < str.size()) {
+        tokens.push_back(str.substr(tokenBegin));
+    }
+    return tokens.size() - count;
+}
+
+std::vector<std::string_view> StringUtils::splitView(std::string_view str, std::string_view separatorsList, bool saveSeparators) {
+    std::vector<std::string_view> tokens;
+    splitView(str, separatorsList, saveSeparators, tokens);
     return tokens;
 }
 
-std::string StringUtils::beforeFirst(const std::string &str, char separator) {
+std::string StringUtils::beforeFirst(std::string_view str, char separator) {
+    return std::string(beforeFirstView(str, separator));
+}
+
+std::string StringUtils::beforeLast(std::string_view str, char separator) {
+    return std::string(beforeLastView(str, separator));
+}
+
+std::string StringUtils::afterFirst(std::string_view str, char separator) {
+    return std::string(afterFirstView(str, separator));
+}
+
+std::string StringUtils::afterLast(std::string_view str, char separator) {
+    return std::string(afterLastView(str, separator));
+}
+
+std::string StringUtils::subStr(std::string_view str, char leftSeparator, char rightSeparator) {
+    return std::string(subStrView(str, leftSeparator, rightSeparator));
+}
+
+std::string_view StringUtils::beforeFirstView(std::string_view str, char separator) {
     return str.substr(0, str.find(separator));
 }
 
-std::string StringUtils::beforeLast(const std::string &str, char separator) {
+std::string_view StringUtils::beforeLastView(std::string_view str, char separator) {
     return str.substr(0, str.rfind(separator));
 }
 
-std::string StringUtils::afterFirst(const std::string &str, char separator) {
+std::string_view StringUtils::afterFirstView(std::string_view str, char separator) {
     return str.substr(str.find(separator) + 1);
 }
 
-std::string StringUtils::afterLast(const std::string &str, char separator) {
+std::string_view StringUtils::afterLastView(std::string_view str, char separator) {
     return str.substr(str.rfind(separator) + 1);
 }
 
-std::string StringUtils::subStr(const std::string &str, char leftSeparator, char rightSeparator) {
+std::string_view StringUtils::subStrView(std::string_view str, char leftSeparator, char rightSeparator) {
     size_t offset = str.find(leftSeparator) + 1;
     size_t count = str.rfind(rightSeparator) - offset;
     return str.substr(offset, count);
 }
 
-std::string StringUtils::replace(const std::string &str, const std::string &from, const std::string &to) {
+std::string StringUtils::replace(std::string_view str, std::string_view from, std::string_view to) {
     size_t startPos = str.find(from);
     if (startPos == std::string::npos) {
-        return str;
+        return std::string(str);
     }
-    std::string result = str;
+    std::string result(str);
     result.replace(startPos, from.length(), to);
     return result;
 }
 
-std::string StringUtils::removeSymbols(const std::string &str, const std::string &symbolsList, bool caseSensitive) {
-    std::string result = str;
+std::string StringUtils::removeSymbols(std::string_view str, std::string_view symbolsList, bool caseSensitive) {
+    std::string result(str);
     for (const auto &ch : symbolsList) {
         if (caseSensitive) {
             result.erase(std::remove(result.begin(), result.end(), ch), result.end());
@@ -75,96 +370,74 @@ std::string StringUtils::removeSymbols(const std::string &str, const std::string
     return result;
 }
 
-size_t StringUtils::symbolsCount(const std::string &str, const std::string &symbolsList, bool caseSensitive) {
-    std::string s1 = caseSensitive ? str : toLower(str);
-    std::string s2 = caseSensitive ? symbolsList : toLower(symbolsList);
+size_t StringUtils::symbolsCount(std::string_view str, std::string_view symbolsList, bool caseSensitive) {
     size_t count = 0;
-    for (const auto &ch : s2) {
-        count += symbolsCount(s1, ch, true);
+    for (const auto &ch : symbolsList) {
+        count += symbolsCount(str, ch, caseSensitive);
     }
     return count;
 }
 
-size_t StringUtils::symbolsCount(const std::string &str, char symbol, bool caseSensitive) {
-    std::string s1 = caseSensitive ? str : toLower(str);
-    char s2 = caseSensitive ? symbol : toLower(symbol);
-    size_t count = 0;
-    for (const auto &ch : s1) {
-        if (ch == s2) {
-            count++;
-        }
+size_t StringUtils::symbolsCount(std::string_view str, char symbol, bool caseSensitive) {
+    char lower = toLower(symbol);
+    char upper = toUpper(symbol);
+    if (caseSensitive || lower == upper) {
+        return std::count(str.begin(), str.end(), symbol);
     }
-    return count;
+    return std::count(str.begin(), str.end(), lower) + std::count(str.begin(), str.end(), upper);
 }
 
-bool StringUtils::contains(const std::string &str, const std::string &findStr, bool caseSensitive) {
-    if (caseSensitive)
-        return str.find(findStr) != str.npos;
-    else
-        return toLower(str).find(toLower(findStr)) != std::string::npos;
+bool StringUtils::contains(std::string_view str, std::string_view findStr, bool caseSensitive) {
+    if (caseSensitive) {
+        return str.find(findStr) != std::string::npos;
+    }
+    return findIgnoreCase(str, findStr) != std::string_view::npos;
 }
 
-bool StringUtils::containsSymbol(const std::string &str, char symbol, bool caseSensitive) {
-    std::string s1 = caseSensitive ? str : toLower(str);
-    char ch = caseSensitive ? symbol : toLower(symbol);
-    for (const auto &it : s1) {
-        if (it == ch) {
-            return true;
-        }
+bool StringUtils::containsSymbol(std::string_view str, char symbol, bool caseSensitive) {
+    if (caseSensitive) {
+        return str.find(symbol) != std::string::npos;
     }
-    return false;
+    return str.find(toLower(symbol)) != std::string::npos || str.find(toUpper(symbol)) != std::string::npos;
 }
 
-bool StringUtils::containsSymbols(const std::string &str, const std::string &symbolsList, bool caseSensitive) {
-    std::string s1 = caseSensitive ? str : toLower(str);
-    std::string s2 = caseSensitive ? symbolsList : toLower(symbolsList);
-    for (const auto &ch : s2) {
-        if (containsSymbol(s1, ch, true)) {
+bool StringUtils::containsSymbols(std::string_view str, std::string_view symbolsList, bool caseSensitive) {
+    SymbolTable table;
+    initSymbolTable(table, symbolsList, caseSensitive);
+    for (const auto &ch : str) {
+        if (hasSymbol(table, static_cast<uint8_t>(ch))) {
             return true;
         }
     }
     return false;
 }
 
-bool StringUtils::compare(const std::string &str1, const std::string &str2, bool caseSensetive) {
+bool StringUtils::compare(std::string_view str1, std::string_view str2, bool caseSensetive) {
     if (caseSensetive) {
-        return strcmp(str1.data(), str2.data()) == 0;
-    }
-    else {
-#ifdef HD_PLATFORM_WIN
-        return _stricmp(str1.data(), str2.data()) == 0;
-#else
-        return strcasecmp(str1.data(), str2.data()) == 0;
-#endif
+        return str1 == str2;
     }
+    return str1.size() == str2.size() && equalsIgnoreCase(str1.data(), str2.data(), str1.size());
 }
 
-bool StringUtils::startsWith(const std::string &str, const std::string &substr, bool caseSensetive) {
+bool StringUtils::startsWith(std::string_view str, std::string_view substr, bool caseSensetive) {
     if (str.size() < substr.size()) {
         return false;
     }
-    std::string s1 = caseSensetive ? str : toLower(str);
-    std::string s2 = caseSensetive ? substr : toLower(substr);
-    for (size_t i = 0; i < s2.size(); i++) {
-        if (s1[i] != s2[i]) {
-            return false;
-        }
+    if (caseSensetive) {
+        return str.compare(0, substr.size(), substr) == 0;
     }
-    return true;
+    return equalsIgnoreCase(str.data(), substr.data(), substr.size());
 }
 
-bool StringUtils::endsWith(const std::string &str, const std::string &substr, bool caseSensetive) {
+bool StringUtils::endsWith(std::string_view str, std::string_view substr, bool caseSensetive) {
     if (str.size() < substr.size()) {
         return false;
     }
-    std::string s1 = caseSensetive ? str : toLower(str);
-    std::string s2 = caseSensetive ? substr : toLower(substr);
-    for (size_t i = 0; i < substr.size(); i++) {
-        if (s1[s1.size() - 1 - i] != s2[s2.size() - 1 - i]) {
-            return false;
+    size_t offset = str.size() - substr.size();
+    if (caseSensetive) {
+        return str.compare(offset, substr.size(), substr) == 0;
     }
-}
-    return true;
+    return equalsIgnoreCase(str.data() + offset, substr.data(), substr.size());
 }
 
 bool StringUtils::isDigit(char ch) {
@@ -175,7 +448,7 @@ bool StringUtils::isAlpha(char ch) {
     return std::isalpha(ch, std::locale());
 }
 
-bool StringUtils::isInt(const std::string &str) {
+bool StringUtils::isInt(std::string_view str) {
     for (const auto &it : str) {
         if (!isDigit(it)) {
             return false;
@@ -184,7 +457,7 @@ bool StringUtils::isInt(const std::string &str) {
     return true;
 }
 
-bool StringUtils::isFloat(const std::string &str) {
+bool StringUtils::isFloat(std::string_view str) {
     if (str.back() != 'f' || symbolsCount(str, ".", false) != 1) {
         return false;
     }
@@ -196,7 +469,7 @@ bool StringUtils::isFloat(const std::string &str) {
     return true;
 }
 
-bool StringUtils::isAlpha(const std::string &str) {
+bool StringUtils::isAlpha(std::string_view str) {
     for (const auto &it : str) {
         if (!isAlpha(it)) {
             return false;
@@ -205,7 +478,7 @@ bool StringUtils::isAlpha(const std::string &str) {
     return true;
 }
 
-bool StringUtils::isAlphaDigit(const std::string &str) {
+bool StringUtils::isAlphaDigit(std::string_view str) {
     for (const auto &it : str) {
         if (!isAlpha(it) && !isDigit(it)) {
             return false;
@@ -214,64 +487,122 @@ bool StringUtils::isAlphaDigit(const std::string &str) {
     return true;
 }
 
-std::wstring StringUtils::toWideString(const std::string &str) {
-    size_t len = str.length() + 1;
+std::wstring StringUtils::toWideString(std::string_view str) {
+    // mbstowcs needs a null terminated string
+    std::string terminated(str);
+    size_t len = terminated.length() + 1;
     std::wstring buf(len, '\0');
-    mbstowcs(buf.data(), str.data(), len);
+    mbstowcs(buf.data(), terminated.data(), len);
     return buf;
 }
 
-std::string StringUtils::fromWideString(const std::wstring &str) {
-    return std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().to_bytes(str);
+std::string StringUtils::fromWideString(std::wstring_view str) {
+    return std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().to_bytes(str.data(), str.data() + str.size());
 }
 
-std::string StringUtils::utf8ToCp1251(const std::string &utf8str) {
+std::string StringUtils::utf8ToCp1251(std::string_view utf8str) {
     std::wstring_convert<std::codecvt_utf8<wchar_t>> wconv;
-    std::wstring wstr = wconv.from_bytes(utf8str);
+    std::wstring wstr = wconv.from_bytes(utf8str.data(), utf8str.data() + utf8str.size());
     std::vector<char> buf(wstr.size());
     std::use_facet<std::ctype<wchar_t>>(std::locale(".1251"))
         .narrow(wstr.data(), wstr.data() + wstr.size(), '?', buf.data());
     return std::string(buf.data(), buf.size());
 }
 
-std::string StringUtils::toUpper(const std::string &str) {
+std::string StringUtils::toUpper(std::string_view str) {
     std::string out(str.size(), '\0');
-    std::transform(str.begin(), str.end(), out.begin(), toupper);
+    for (size_t i = 0; i < str.size(); i++) {
+        out[i] = static_cast<char>(CASE_TABLE.upper[static_cast<uint8_t>(str[i])]);
+    }
     return out;
 }
 
 char StringUtils::toUpper(char ch) {
-    return std::toupper(ch, std::locale());
+    return static_cast<char>(CASE_TABLE.upper[static_cast<uint8_t>(ch)]);
+}
+
+std::string StringUtils::toUpper(std::string_view str, const std::locale &locale) {
+    std::string out(str);
+    std::use_facet<std::ctype<char>>(locale).toupper(out.data(), out.data() + out.size());
+    return out;
 }
 
-std::string StringUtils::toLower(const std::string &str) {
+char StringUtils::toUpper(char ch, const std::locale &locale) {
+    return std::toupper(ch, locale);
+}
+
+std::string StringUtils::toLower(std::string_view str) {
     std::string out(str.size(), '\0');
-    std::transform(str.begin(), str.end(), out.begin(), tolower);
+    for (size_t i = 0; i < str.size(); i++) {
+        out[i] = static_cast<char>(CASE_TABLE.lower[static_cast<uint8_t>(str[i])]);
+    }
     return out;
 }
 
 char StringUtils::toLower(char ch) {
-    return std::tolower(ch, std::locale());
+    return static_cast<char>(CASE_TABLE.lower[static_cast<uint8_t>(ch)]);
 }
 
-bool StringUtils::toBool(const std::string &str) {
+std::string StringUtils::toLower(std::string_view str, const std::locale &locale) {
+    std::string out(str);
+    std::use_facet<std::ctype<char>>(locale).tolower(out.data(), out.data() + out.size());
+    return out;
+}
+
+char StringUtils::toLower(char ch, const std::locale &locale) {
+    return std::tolower(ch, locale);
+}
+
+bool StringUtils::toBool(std::string_view str) {
     return compare(str, "true", false);
 }
 
-int StringUtils::toInt(const std::string &str) {
-    return std::stoi(str);
+int StringUtils::toInt(std::string_view str) {
+    return toNumber<int>(str, "StringUtils::toInt");
+}
+
+uint64_t StringUtils::toUint64(std::string_view str) {
+    return toNumber<uint64_t>(str, "StringUtils::toUint64");
+}
+
+float StringUtils::toFloat(std::string_view str) {
+    return toNumber<float>(str, "StringUtils::toFloat");
+}
+
+double StringUtils::toDouble(std::string_view str) {
+    return toNumber<double>(str, "StringUtils::toDouble");
+}
+
+std::optional<int> StringUtils::parseInt(std::string_view str) {
+    return parseNumber<int>(str);
+}
+
+std::optional<uint64_t> StringUtils::parseUint64(std::string_view str) {
+    return parseNumber<uint64_t>(str);
+}
+
+std::optional<float> StringUtils::parseFloat(std::string_view str) {
+    return parseNumber<float>(str);
+}
+
+std::optional<double> StringUtils::parseDouble(std::string_view str) {
+    return parseNumber<double>(str);
+}
+
+bool StringUtils::parseArray(std::string_view str, std::vector<int> &values) {
+    return parseNumberArray(str, values);
 }
 
-uint64_t StringUtils::toUint64(const std::string &str) {
-    return std::stoull(str);
+bool StringUtils::parseArray(std::string_view str, std::vector<uint32_t> &values) {
+    return parseNumberArray(str, values);
 }
 
-float StringUtils::toFloat(const std::string &str) {
-    return std::stof(str);
+bool StringUtils::parseArray(std::string_view str, std::vector<float> &values) {
+    return parseNumberArray(str, values);
 }
 
-double StringUtils::toDouble(const std::string &str) {
-    return std::stod(str);
+bool StringUtils::parseArray(std::string_view str, std::vector<double> &values) {
+    return parseNumberArray(str, values);
 }
 
 std::string StringUtils::fromBool(bool value) {
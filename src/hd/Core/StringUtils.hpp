@@ -1,55 +1,88 @@
 #pragma once
 #include "Common.hpp"
 #include <string>
+#include <string_view>
+#include <vector>
+#include <locale>
+#include <optional>
 #include <regex>
 #include <unordered_map>
 
 namespace hd {
 
+// Case insensitive functions and toLower/toUpper fold ASCII letters only and don't allocate,
+// the overloads taking a std::locale handle other alphabets.
 class StringUtils : public StaticClass {
 public:
-    static std::vector<std::string> split(const std::string &str, const std::string &separatorsList, bool saveSeparators);
-    static std::string beforeFirst(const std::string &str, char separator);
-    static std::string beforeLast(const std::string &str, char separator);
-    static std::string afterFirst(const std::string &str, char separator);
-    static std::string afterLast(const std::string &str, char separator);
-    static std::string subStr(const std::string &str, char leftSeparator, char rightSeparator);
-    static std::string replace(const std::string &str, const std::string &from, const std::string &to);
-    static std::string removeSymbols(const std::string &str, const std::string &symbolsList, bool caseSensitive);
-    static size_t symbolsCount(const std::string &str, const std::string &symbolsList, bool caseSensitive);
-    static size_t symbolsCount(const std::string &str, char symbol, bool caseSensitive);
-    static bool contains(const std::string &str, const std::string &findStr, bool caseSensitive);
-    static bool containsSymbols(const std::string &str, const std::string &symbolsList, bool caseSensitive);
-    static bool containsSymbol(const std::string &str, char symbol, bool caseSensitive);
-    static bool compare(const std::string &str1, const std::string &str2, bool caseSensetive);
-    static bool startsWith(const std::string &str, const std::string &substr, bool caseSensetive);
-    static bool endsWith(const std::string &str, const std::string &substr, bool caseSensetive);
+    static std::vector<std::string> split(std::string_view str, std::string_view separatorsList, bool saveSeparators);
+    // Appends the tokens of split as views into str without allocating per token, returns the number of appended tokens.
+    // Separators are found with a 256 bit table, a few of them are matched 16 or 32 bytes at a time with SIMD.
+    static size_t splitView(std::string_view str, std::string_view separatorsList, bool saveSeparators, std::vector<std::string_view> &tokens);
+    static std::vector<std::string_view> splitView(std::string_view str, std::string_view separatorsList, bool saveSeparators);
+    static std::string beforeFirst(std::string_view str, char separator);
+    static std::string beforeLast(std::string_view str, char separator);
+    static std::string afterFirst(std::string_view str, char separator);
+    static std::string afterLast(std::string_view str, char separator);
+    static std::string subStr(std::string_view str, char leftSeparator, char rightSeparator);
+    // Same as above, returning views into str
+    static std::string_view beforeFirstView(std::string_view str, char separator);
+    static std::string_view beforeLastView(std::string_view str, char separator);
+    static std::string_view afterFirstView(std::string_view str, char separator);
+    static std::string_view afterLastView(std::string_view str, char separator);
+    static std::string_view subStrView(std::string_view str, char leftSeparator, char rightSeparator);
+    static std::string replace(std::string_view str, std::string_view from, std::string_view to);
+    static std::string removeSymbols(std::string_view str, std::string_view symbolsList, bool caseSensitive);
+    static size_t symbolsCount(std::string_view str, std::string_view symbolsList, bool caseSensitive);
+    static size_t symbolsCount(std::string_view str, char symbol, bool caseSensitive);
+    static bool contains(std::string_view str, std::string_view findStr, bool caseSensitive);
+    static bool containsSymbols(std::string_view str, std::string_view symbolsList, bool caseSensitive);
+    static bool containsSymbol(std::string_view str, char symbol, bool caseSensitive);
+    static bool compare(std::string_view str1, std::string_view str2, bool caseSensetive);
+    static bool startsWith(std::string_view str, std::string_view substr, bool caseSensetive);
+    static bool endsWith(std::string_view str, std::string_view substr, bool caseSensetive);
     static bool isDigit(char ch);
     static bool isAlpha(char ch);
-    static bool isInt(const std::string &str);
-    static bool isFloat(const std::string &str);
-    static bool isAlpha(const std::string &str);
-    static bool isAlphaDigit(const std::string &str);
-    static std::wstring toWideString(const std::string &str);
-    static std::string fromWideString(const std::wstring &str);
-    static std::string utf8ToCp1251(const std::string &utf8str);
-    static std::string toUpper(const std::string &str);
+    static bool isInt(std::string_view str);
+    static bool isFloat(std::string_view str);
+    static bool isAlpha(std::string_view str);
+    static bool isAlphaDigit(std::string_view str);
+    static std::wstring toWideString(std::string_view str);
+    static std::string fromWideString(std::wstring_view str);
+    static std::string utf8ToCp1251(std::string_view utf8str);
+    static std::string toUpper(std::string_view str);
     static char toUpper(char ch);
-    static std::string toLower(const std::string &str);
+    static std::string toUpper(std::string_view str, const std::locale &locale);
+    static char toUpper(char ch, const std::locale &locale);
+    static std::string toLower(std::string_view str);
     static char toLower(char ch);
-    static bool toBool(const std::string &str);
-    static int toInt(const std::string &str);
-    static uint64_t toUint64(const std::string &str);
-    static float toFloat(const std::string &str);
-    static double toDouble(const std::string &str);
+    static std::string toLower(std::string_view str, const std::locale &locale);
+    static char toLower(char ch, const std::locale &locale);
+    static bool toBool(std::string_view str);
+    // Same input rules and exceptions as std::sto*, except that hexadecimal floats aren't accepted and the locale is ignored
+    static int toInt(std::string_view str);
+    static uint64_t toUint64(std::string_view str);
+    static float toFloat(std::string_view str);
+    static double toDouble(std::string_view str);
+    // Whole string must be a number in the format of std::from_chars, no whitespace, no leading '+'
+    static std::optional<int> parseInt(std::string_view str);
+    static std::optional<uint64_t> parseUint64(std::string_view str);
+    static std::optional<float> parseFloat(std::string_view str);
+    static std::optional<double> parseDouble(std::string_view str);
+    // Appends numbers separated by whitespace and commas, e.g. "1.0, 2.5 3", returns false at the first malformed number
+    static bool parseArray(std::string_view str, std::vector<int> &values);
+    static bool parseArray(std::string_view str, std::vector<uint32_t> &values);
+    static bool parseArray(std::string_view str, std::vector<float> &values);
+    static bool parseArray(std::string_view str, std::vector<double> &values);
     static std::string fromBool(bool value);
     static const std::string &getEmpty();
 
     template<typename T, typename F>
-    static std::string unite(const T &v, const std::string &prefix, const std::string &postfix, const std::string &separator, F getStringFunc) {
+    static std::string unite(const T &v, std::string_view prefix, std::string_view postfix, std::string_view separator, F getStringFunc) {
         std::string str;
         for (auto it = v.begin(); it != v.end(); it++) {
-            str += prefix + getStringFunc(*it) + postfix;
+            str += prefix;
+            str += getStringFunc(*it);
+            str += postfix;
             if (it != (v.end() - 1)) {
                 str += separator;
             }
@@ -58,10 +91,12 @@ public:
     }
 
     template<typename T>
-    static std::string unite(const T &v, const std::string &prefix, const std::string &postfix, const std::string &separator) {
+    static std::string unite(const T &v, std::string_view prefix, std::string_view postfix, std::string_view separator) {
         std::string str;
         for (auto it = v.begin(); it != v.end(); it++) {
-            str += prefix + *it + postfix;
+            str += prefix;
+            str += *it;
+            str += postfix;
             if (it != (v.end() - 1)) {
                 str += separator;
             }
@@ -1,93 +1,726 @@
 #include "Image.hpp"
 #include "FileStream.hpp"
 #include "../Core/Log.hpp"
+#include <array>
+#include <algorithm>
+#include <cmath>
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
 #include "../../stb/stb_image.h"
 
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_F16C)
+#   include <immintrin.h>
+#endif
+
 namespace hd {
 
+static stbi_io_callbacks getStreamCallbacks() {
+    stbi_io_callbacks callbacks;
+    callbacks.read = [](void *userdata, char *data, int size) {
+        Stream *stream = static_cast<Stream*>(userdata);
+        return static_cast<int>(stream->read(data, static_cast<size_t>(size)));
+    };
+    callbacks.skip = [](void *userdata, int size) {
+        Stream *stream = static_cast<Stream*>(userdata);
+        stream->seek(stream->tell() + static_cast<size_t>(size));
+    };
+    callbacks.eof = [](void *userdata) {
+        Stream *stream = static_cast<Stream*>(userdata);
+        return static_cast<int>(stream->isEOF());
+    };
+    return callbacks;
+}
+
+static ImageComponentType getNativeComponentType(Stream &stream) {
+    size_t startPos = stream.tell();
+    stbi_io_callbacks callbacks = getStreamCallbacks();
+    bool isHDR = stbi_is_hdr_from_callbacks(&callbacks, &stream) != 0;
+    stream.seek(startPos);
+    bool is16Bit = !isHDR && stbi_is_16_bit_from_callbacks(&callbacks, &stream) != 0;
+    stream.seek(startPos);
+    return isHDR ? ImageComponentType::F32 : (is16Bit ? ImageComponentType::U16 : ImageComponentType::U8);
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment*alignment;
+}
+
+static glm::ivec2 getLevelSize(const glm::ivec2 &size, size_t level) {
+    return glm::max(glm::ivec2(size.x >> level, size.y >> level), glm::ivec2(1, 1));
+}
+
+static size_t computeMipLayout(const glm::ivec2 &size, size_t pixelSize, size_t mipCount, std::vector<size_t> &offsets) {
+    offsets.resize(mipCount);
+    size_t offset = 0;
+    for (size_t i = 0; i < mipCount; i++) {
+        glm::ivec2 levelSize = getLevelSize(size, i);
+        offsets[i] = offset;
+        offset = alignUp(offset + static_cast<size_t>(levelSize.x)*static_cast<size_t>(levelSize.y)*pixelSize, HDImgHeader::MIP_ALIGNMENT);
+    }
+    return offset;
+}
+
+static void flipRows(uint8_t *data, const glm::ivec2 &size, size_t pixelSize) {
+    size_t rowSize = static_cast<size_t>(size.x)*pixelSize;
+    std::vector<uint8_t> row(rowSize);
+    for (int y = 0; y < size.y / 2; y++) {
+        uint8_t *top = data + static_cast<size_t>(y)*rowSize;
+        uint8_t *bottom = data + static_cast<size_t>(size.y - 1 - y)*rowSize;
+        memcpy(row.data(), top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, row.data(), rowSize);
+    }
+}
+
+static float halfToFloat(uint16_t value) {
+    static const uint32_t shiftedExp = 0x7C00 << 13;
+    uint32_t bits = (value & 0x7FFFu) << 13;
+    uint32_t exp = bits & shiftedExp;
+    bits += (127 - 15) << 23;
+    if (exp == shiftedExp) {
+        bits += (128 - 16) << 23; // Inf/NaN
+    }
+    else if (exp == 0) {
+        // Zero/denormal, renormalize through the FPU
+        static const uint32_t magicBits = 113 << 23;
+        float magic;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        bits += 1 << 23;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        f -= magic;
+        memcpy(&bits, &f, sizeof(bits));
+    }
+    bits |= static_cast<uint32_t>(value & 0x8000u) << 16;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t result;
+    if (bits >= (127u + 16) << 23) {
+        result = bits > (255u << 23) ? 0x7E00 : 0x7C00; // NaN stays NaN, overflow goes to Inf
+    }
+    else if (bits < (113u << 23)) {
+        // Denormal or zero, let the FPU do the rounding
+        static const uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+        float denormMagic, f;
+        memcpy(&denormMagic, &denormMagicBits, sizeof(denormMagic));
+        memcpy(&f, &bits, sizeof(f));
+        f += denormMagic;
+        memcpy(&bits, &f, sizeof(bits));
+        result = bits - denormMagicBits;
+    }
+    else {
+        // Round to nearest even
+        uint32_t mantOdd = (bits >> 13) & 1;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + mantOdd;
+        result = bits >> 13;
+    }
+    return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+static void convertF32ToF16(const float *src, uint16_t *dst, size_t count) {
+    size_t i = 0;
+#ifdef HD_SIMD_F16C
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = floatToHalf(src[i]);
+    }
+}
+
+static void convertF16ToF32(const uint16_t *src, float *dst, size_t count) {
+    size_t i = 0;
+#ifdef HD_SIMD_F16C
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = halfToFloat(src[i]);
+    }
+}
+
+static void convertU8ToF32(const uint8_t *src, float *dst, size_t count) {
+    static const auto table = []() {
+        std::array<float, 256> table;
+        for (int i = 0; i < 256; i++) {
+            table[i] = static_cast<float>(i) / 255.0f;
+        }
+        return table;
+    }();
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = table[src[i]];
+    }
+}
+
+// NaN fails both comparisons and becomes 0, the same as with _mm_max_ps against zero
+static float clampUnit(float value) {
+    return value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+}
+
+static void convertF32ToU8(const float *src, uint8_t *dst, size_t count) {
+    size_t i = 0;
+#ifdef HD_SIMD_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v[4];
+        for (int k = 0; k < 4; k++) {
+            __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + k*4), zero), one);
+            v[k] = _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+        }
+        __m128i lo = _mm_packs_epi32(v[0], v[1]);
+        __m128i hi = _mm_packs_epi32(v[2], v[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        // Rounds half to even like _mm_cvtps_epi32 above
+        dst[i] = static_cast<uint8_t>(std::nearbyint(clampUnit(src[i])*255.0f));
+    }
+}
+
+static void convertU16ToF32(const uint16_t *src, float *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<float>(src[i])*(1.0f / 65535.0f);
+    }
+}
+
+static void convertF32ToU16(const float *src, uint16_t *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<uint16_t>(clampUnit(src[i])*65535.0f + 0.5f);
+    }
+}
+
+static void convertToF32(const void *src, ImageComponentType srcType, float *dst, size_t count) {
+    switch (srcType) {
+        case ImageComponentType::U8: {
+            convertU8ToF32(static_cast<const uint8_t*>(src), dst, count);
+            break;
+        }
+        case ImageComponentType::U16: {
+            convertU16ToF32(static_cast<const uint16_t*>(src), dst, count);
+            break;
+        }
+        case ImageComponentType::F16: {
+            convertF16ToF32(static_cast<const uint16_t*>(src), dst, count);
+            break;
+        }
+        case ImageComponentType::F32: {
+            memcpy(dst, src, count*sizeof(float));
+            break;
+        }
+        default: {
+            HD_ASSERT(false);
+        }
+    }
+}
+
+static void convertFromF32(const float *src, void *dst, ImageComponentType dstType, size_t count) {
+    switch (dstType) {
+        case ImageComponentType::U8: {
+            convertF32ToU8(src, static_cast<uint8_t*>(dst), count);
+            break;
+        }
+        case ImageComponentType::U16: {
+            convertF32ToU16(src, static_cast<uint16_t*>(dst), count);
+            break;
+        }
+        case ImageComponentType::F16: {
+            convertF32ToF16(src, static_cast<uint16_t*>(dst), count);
+            break;
+        }
+        case ImageComponentType::F32: {
+            memcpy(dst, src, count*sizeof(float));
+            break;
+        }
+        default: {
+            HD_ASSERT(false);
+        }
+    }
+}
+
+template<typename T>
+struct ComponentTraits;
+
+template<>
+struct ComponentTraits<uint8_t> {
+    static uint8_t one() { return 255; }
+    static uint8_t luma(uint8_t r, uint8_t g, uint8_t b) { return static_cast<uint8_t>((r*77 + g*150 + b*29) >> 8); }
+    static uint8_t average(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { return static_cast<uint8_t>((a + b + c + d + 2) >> 2); }
+};
+
+template<>
+struct ComponentTraits<uint16_t> {
+    static uint16_t one() { return 65535; }
+    static uint16_t luma(uint16_t r, uint16_t g, uint16_t b) { return static_cast<uint16_t>((r*77u + g*150u + b*29u) >> 8); }
+    static uint16_t average(uint16_t a, uint16_t b, uint16_t c, uint16_t d) { return static_cast<uint16_t>((a + b + c + d + 2u) >> 2); }
+};
+
+template<>
+struct ComponentTraits<float> {
+    static float one() { return 1.0f; }
+    static float luma(float r, float g, float b) { return (r*77.0f + g*150.0f + b*29.0f)*(1.0f / 256.0f); }
+    static float average(float a, float b, float c, float d) { return (a + b + c + d)*0.25f; }
+};
+
+template<typename T>
+static void convertPixelsImpl(const T *src, ImageFormat srcFmt, T *dst, ImageFormat dstFmt, size_t count) {
+    int srcChannels = static_cast<int>(srcFmt);
+    int dstChannels = static_cast<int>(dstFmt);
+    bool srcHasAlpha = srcFmt == ImageFormat::GreyAlpha || srcFmt == ImageFormat::RGBA;
+    for (size_t i = 0; i < count; i++, src += srcChannels, dst += dstChannels) {
+        T r, g, b, a;
+        if (srcChannels >= 3) {
+            r = src[0];
+            g = src[1];
+            b = src[2];
+        }
+        else {
+            r = g = b = src[0];
+        }
+        a = srcHasAlpha ? src[srcChannels - 1] : ComponentTraits<T>::one();
+
+        switch (dstFmt) {
+            case ImageFormat::Grey:
+            case ImageFormat::GreyAlpha: {
+                // Same luma weights as stb_image uses for its own conversions
+                dst[0] = ComponentTraits<T>::luma(r, g, b);
+                if (dstFmt == ImageFormat::GreyAlpha) {
+                    dst[1] = a;
+                }
+                break;
+            }
+            case ImageFormat::RGB:
+            case ImageFormat::RGBA: {
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+                if (dstFmt == ImageFormat::RGBA) {
+                    dst[3] = a;
+                }
+                break;
+            }
+            default: {
+                HD_ASSERT(false);
+            }
+        }
+    }
+}
+
+template<typename T>
+static void downsampleImpl(const T *src, const glm::ivec2 &srcSize, T *dst, const glm::ivec2 &dstSize, int channels) {
+    for (int y = 0; y < dstSize.y; y++) {
+        const T *row0 = src + static_cast<size_t>(glm::min(y*2, srcSize.y - 1))*static_cast<size_t>(srcSize.x)*static_cast<size_t>(channels);
+        const T *row1 = src + static_cast<size_t>(glm::min(y*2 + 1, srcSize.y - 1))*static_cast<size_t>(srcSize.x)*static_cast<size_t>(channels);
+        for (int x = 0; x < dstSize.x; x++) {
+            int x0 = glm::min(x*2, srcSize.x - 1)*channels;
+            int x1 = glm::min(x*2 + 1, srcSize.x - 1)*channels;
+            for (int c = 0; c < channels; c++) {
+                *dst++ = ComponentTraits<T>::average(row0[x0 + c], row0[x1 + c], row1[x0 + c], row1[x1 + c]);
+            }
+        }
+    }
+}
+
+static void downsample(const uint8_t *src, const glm::ivec2 &srcSize, uint8_t *dst, const glm::ivec2 &dstSize, int channels, ImageComponentType type) {
+    switch (type) {
+        case ImageComponentType::U8: {
+            downsampleImpl(src, srcSize, dst, dstSize, channels);
+            break;
+        }
+        case ImageComponentType::U16: {
+            downsampleImpl(reinterpret_cast<const uint16_t*>(src), srcSize, reinterpret_cast<uint16_t*>(dst), dstSize, channels);
+            break;
+        }
+        case ImageComponentType::F16: {
+            size_t srcCount = static_cast<size_t>(srcSize.x)*static_cast<size_t>(srcSize.y)*static_cast<size_t>(channels);
+            size_t dstCount = static_cast<size_t>(dstSize.x)*static_cast<size_t>(dstSize.y)*static_cast<size_t>(channels);
+            std::vector<float> srcFloats(srcCount), dstFloats(dstCount);
+            convertF16ToF32(reinterpret_cast<const uint16_t*>(src), srcFloats.data(), srcCount);
+            downsampleImpl(srcFloats.data(), srcSize, dstFloats.data(), dstSize, channels);
+            convertF32ToF16(dstFloats.data(), reinterpret_cast<uint16_t*>(dst), dstCount);
+            break;
+        }
+        case ImageComponentType::F32: {
+            downsampleImpl(reinterpret_cast<const float*>(src), srcSize, reinterpret_cast<float*>(dst), dstSize, channels);
+            break;
+        }
+        default: {
+            HD_ASSERT(false);
+        }
+    }
+}
+
+static void writeData(Stream &stream, const void *data, size_t size) {
+    HD_ASSERT(stream.write(data, size) == size);
+}
+
+static void writeBigEndian32(uint8_t *dst, uint32_t value) {
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+static uint32_t computeCRC32(uint32_t crc, const uint8_t *data, size_t size) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void writePNGChunk(Stream &stream, const char *type, const uint8_t *data, size_t size) {
+    uint8_t header[8];
+    writeBigEndian32(header, static_cast<uint32_t>(size));
+    memcpy(header + 4, type, 4);
+    uint32_t crc = computeCRC32(0, header + 4, 4);
+    crc = computeCRC32(crc, data, size);
+    uint8_t footer[4];
+    writeBigEndian32(footer, crc);
+
+    writeData(stream, header, sizeof(header));
+    writeData(stream, data, size);
+    writeData(stream, footer, sizeof(footer));
+}
+
+ImageInfo::ImageInfo() : size(0, 0) {
+    this->fmt = ImageFormat::None;
+    this->type = ImageComponentType::None;
+}
+
 Image::Image() : mSize(0, 0) {
     mFmt = ImageFormat::None;
+    mType = ImageComponentType::None;
 }
 
-Image::Image(const void *data, const glm::ivec2 &size, ImageFormat fmt) : Image() {
-    create(data, size, fmt);
+Image::Image(const void *data, const glm::ivec2 &size, ImageFormat fmt, ImageComponentType type) : Image() {
+    create(data, size, fmt, type);
 }
 
-Image::Image(Stream &stream, ImageFormat requiredFmt, bool flipVertically) : Image() {
-    create(stream, requiredFmt, flipVertically);
+Image::Image(Stream &stream, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) : Image() {
+    create(stream, requiredFmt, flipVertically, requiredType);
 }
 
-Image::Image(const std::string &path, ImageFormat requiredFmt, bool flipVertically) : Image() {
-    create(path, requiredFmt, flipVertically);
+Image::Image(const std::string &path, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) : Image() {
+    create(path, requiredFmt, flipVertically, requiredType);
 }
 
 Image::~Image() {
     destroy();
 }
 
-void Image::create(const void *data, const glm::ivec2 &size, ImageFormat fmt) {
+void Image::create(const void *data, const glm::ivec2 &size, ImageFormat fmt, ImageComponentType type) {
     destroy();
     HD_ASSERT(size.x > 0);
     HD_ASSERT(size.y > 0);
     HD_ASSERT(fmt != ImageFormat::None);
+    HD_ASSERT(type != ImageComponentType::None);
 
-    size_t dataSize = static_cast<size_t>(size.x*size.y*static_cast<int>(fmt));
+    size_t dataSize = static_cast<size_t>(size.x)*static_cast<size_t>(size.y)*static_cast<size_t>(fmt)*getComponentSize(type);
     mData.resize(dataSize);
+    mMipOffsets.assign(1, 0);
     mSize = size;
     mFmt = fmt;
+    mType = type;
 
     if (data) {
         memcpy(mData.data(), data, dataSize);
     }
 }
 
-void Image::create(Stream &stream, ImageFormat requiredFmt, bool flipVertically) {
+void Image::create(Stream &stream, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) {
     HD_ASSERT(stream.isReadable());
 
     mPath = stream.getName();
 
-    stbi_io_callbacks callbacks;
-    callbacks.read = [](void *userdata, char *data, int size) {
-        Stream *stream = static_cast<Stream*>(userdata);
-        return static_cast<int>(stream->read(data, static_cast<size_t>(size)));
-    };
-    callbacks.skip = [](void *userdata, int size) {
-        Stream *stream = static_cast<Stream*>(userdata);
-        stream->seek(stream->tell() + static_cast<size_t>(size));
-    };
-    callbacks.eof = [](void *userdata) {
-        Stream *stream = static_cast<Stream*>(userdata);
-        return static_cast<int>(stream->isEOF());
-    };
+    size_t startPos = stream.tell();
+    uint32_t magic = 0;
+    bool isHDImg = stream.read(magic) == sizeof(magic) && magic == HDImgHeader::MAGIC;
+    stream.seek(startPos);
+    if (isHDImg) {
+        createFromHDImg(stream, requiredFmt, flipVertically, requiredType);
+        return;
+    }
+
+    ImageComponentType nativeType = getNativeComponentType(stream);
+    ImageComponentType type = requiredType != ImageComponentType::None ? requiredType : nativeType;
+    // stb_image applies a gamma curve when loading LDR files as float, so they are loaded natively and converted
+    // linearly by convertComponents. HDR files loaded as integers keep the stb_image tonemap.
+    ImageComponentType loadType = type == ImageComponentType::F16 ? ImageComponentType::F32 : type;
+    if (loadType == ImageComponentType::F32 && nativeType != ImageComponentType::F32) {
+        loadType = nativeType;
+    }
+    stbi_io_callbacks callbacks = getStreamCallbacks();
+
+    // The thread local flag, ImageCache decodes on several threads at once
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
 
-    stbi_set_flip_vertically_on_load(flipVertically);
-    
     int width, height, components;
-    uint8_t *data = stbi_load_from_callbacks(&callbacks, &stream, &width, &height, &components, static_cast<int>(requiredFmt));
+    void *data;
+    if (loadType == ImageComponentType::F32) {
+        data = stbi_loadf_from_callbacks(&callbacks, &stream, &width, &height, &components, static_cast<int>(requiredFmt));
+    }
+    else if (loadType == ImageComponentType::U16) {
+        data = stbi_load_16_from_callbacks(&callbacks, &stream, &width, &height, &components, static_cast<int>(requiredFmt));
+    }
+    else {
+        data = stbi_load_from_callbacks(&callbacks, &stream, &width, &height, &components, static_cast<int>(requiredFmt));
+    }
     if (!data) {
         HD_LOG_FATAL("Failed to load image from stream '{}'. Error: {}", stream.getName().data(), stbi_failure_reason());
     }
-    if (requiredFmt != ImageFormat::None) {
-        HD_ASSERT(components == static_cast<int>(requiredFmt));
-        create(data, glm::ivec2(width, height), requiredFmt);
+    ImageFormat fmt = requiredFmt != ImageFormat::None ? requiredFmt : static_cast<ImageFormat>(components);
+    if (type == ImageComponentType::F16 && loadType == ImageComponentType::F32) {
+        create(nullptr, glm::ivec2(width, height), fmt, type);
+        convertF32ToF16(static_cast<const float*>(data), reinterpret_cast<uint16_t*>(mData.data()), static_cast<size_t>(width)*static_cast<size_t>(height)*static_cast<size_t>(fmt));
     }
     else {
-        create(data, glm::ivec2(width, height), static_cast<ImageFormat>(components));
+        create(data, glm::ivec2(width, height), fmt, loadType);
     }
     stbi_image_free(data);
+    if (mType != type) {
+        convert(type);
+    }
 }
 
-void Image::create(const std::string &path, ImageFormat requiredFmt, bool flipVertically) {
+void Image::create(const std::string &path, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) {
     FileStream fs(path, FileMode::Read);
-    create(fs, requiredFmt, flipVertically);
+    create(fs, requiredFmt, flipVertically, requiredType);
+}
+
+void Image::generateMipmaps() {
+    HD_ASSERT(mFmt != ImageFormat::None);
+
+    size_t mipCount = 1;
+    while (mipCount < HDImgHeader::MAX_MIPS && ((mSize.x >> mipCount) > 0 || (mSize.y >> mipCount) > 0)) {
+        mipCount++;
+    }
+
+    std::vector<size_t> offsets;
+    size_t dataSize = computeMipLayout(mSize, getPixelSize(), mipCount, offsets);
+    mData.resize(dataSize);
+    mMipOffsets = offsets;
+
+    for (size_t i = 1; i < mipCount; i++) {
+        downsample(mData.data() + mMipOffsets[i - 1], getMipSize(i - 1), mData.data() + mMipOffsets[i], getMipSize(i), static_cast<int>(mFmt), mType);
+    }
+}
+
+void Image::convert(ImageComponentType type) {
+    HD_ASSERT(mFmt != ImageFormat::None);
+    HD_ASSERT(type != ImageComponentType::None);
+    if (type == mType) {
+        return;
+    }
+
+    size_t channels = static_cast<size_t>(mFmt);
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> data(computeMipLayout(mSize, channels*getComponentSize(type), mMipOffsets.size(), offsets));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        glm::ivec2 levelSize = getMipSize(i);
+        convertComponents(mData.data() + mMipOffsets[i], mType, data.data() + offsets[i], type, static_cast<size_t>(levelSize.x)*static_cast<size_t>(levelSize.y)*channels);
+    }
+    mData = std::move(data);
+    mMipOffsets = offsets;
+    mType = type;
+}
+
+void Image::save(Stream &stream, ImageFileFormat fileFmt) const {
+    HD_ASSERT(stream.isWritable());
+    HD_ASSERT(mFmt != ImageFormat::None);
+
+    switch (fileFmt) {
+        case ImageFileFormat::PNG: {
+            saveToPNG(stream);
+            break;
+        }
+        case ImageFileFormat::TGA: {
+            saveToTGA(stream);
+            break;
+        }
+        case ImageFileFormat::HDImg: {
+            saveToHDImg(stream);
+            break;
+        }
+    }
+}
+
+void Image::save(const std::string &path, ImageFileFormat fileFmt) const {
+    FileStream fs(path, FileMode::Write);
+    save(fs, fileFmt);
+}
+
+ImageInfo Image::probe(Stream &stream) {
+    HD_ASSERT(stream.isReadable());
+
+    // stb_image reads only the header, rewind afterwards so the same stream can be decoded right after probing
+    size_t startPos = stream.tell();
+    ImageInfo info;
+
+    HDImgHeader header;
+    if (stream.read(header) == sizeof(header) && header.magic == HDImgHeader::MAGIC) {
+        // Reject what the loader would reject, fields of other versions can't be trusted
+        if (header.version == HDImgHeader::VERSION) {
+            info.size = glm::ivec2(header.width, header.height);
+            info.fmt = static_cast<ImageFormat>(header.format);
+            info.type = static_cast<ImageComponentType>(header.componentType);
+        }
+        else {
+            HD_LOG_ERROR("Failed to probe image from stream '{}'. Error: unsupported HDImg header", stream.getName().data());
+        }
+        stream.seek(startPos);
+        return info;
+    }
+    stream.seek(startPos);
+
+    stbi_io_callbacks callbacks = getStreamCallbacks();
+    int width, height, components;
+    if (stbi_info_from_callbacks(&callbacks, &stream, &width, &height, &components)) {
+        stream.seek(startPos);
+        info.size = glm::ivec2(width, height);
+        info.fmt = static_cast<ImageFormat>(components);
+        info.type = getNativeComponentType(stream);
+    }
+    else {
+        HD_LOG_ERROR("Failed to probe image from stream '{}'. Error: {}", stream.getName().data(), stbi_failure_reason());
+    }
+    stream.seek(startPos);
+    return info;
+}
+
+ImageInfo Image::probe(const std::string &path) {
+    FileStream fs(path, FileMode::Read);
+    return probe(fs);
+}
+
+size_t Image::getComponentSize(ImageComponentType type) {
+    switch (type) {
+        case ImageComponentType::U8: {
+            return 1;
+        }
+        case ImageComponentType::U16:
+        case ImageComponentType::F16: {
+            return 2;
+        }
+        case ImageComponentType::F32: {
+            return 4;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+void Image::convertPixels(const void *src, ImageFormat srcFmt, void *dst, ImageFormat dstFmt, size_t count, ImageComponentType type) {
+    switch (type) {
+        case ImageComponentType::U8: {
+            convertPixelsImpl(static_cast<const uint8_t*>(src), srcFmt, static_cast<uint8_t*>(dst), dstFmt, count);
+            break;
+        }
+        case ImageComponentType::U16: {
+            convertPixelsImpl(static_cast<const uint16_t*>(src), srcFmt, static_cast<uint16_t*>(dst), dstFmt, count);
+            break;
+        }
+        case ImageComponentType::F16: {
+            // Halves are converted through a small float buffer
+            static const size_t batchSize = 256;
+            float srcFloats[batchSize*4], dstFloats[batchSize*4];
+            size_t srcChannels = static_cast<size_t>(srcFmt);
+            size_t dstChannels = static_cast<size_t>(dstFmt);
+            const uint16_t *srcHalfs = static_cast<const uint16_t*>(src);
+            uint16_t *dstHalfs = static_cast<uint16_t*>(dst);
+            for (size_t i = 0; i < count; i += batchSize) {
+                size_t batch = std::min(batchSize, count - i);
+                convertF16ToF32(srcHalfs + i*srcChannels, srcFloats, batch*srcChannels);
+                convertPixelsImpl(srcFloats, srcFmt, dstFloats, dstFmt, batch);
+                convertF32ToF16(dstFloats, dstHalfs + i*dstChannels, batch*dstChannels);
+            }
+            break;
+        }
+        case ImageComponentType::F32: {
+            convertPixelsImpl(static_cast<const float*>(src), srcFmt, static_cast<float*>(dst), dstFmt, count);
+            break;
+        }
+        default: {
+            HD_ASSERT(false);
+        }
+    }
+}
+
+void Image::convertComponents(const void *src, ImageComponentType srcType, void *dst, ImageComponentType dstType, size_t count) {
+    HD_ASSERT(srcType != ImageComponentType::None);
+    HD_ASSERT(dstType != ImageComponentType::None);
+
+    // Direct kernels for the common pairs, the rest goes through a float buffer
+    if (srcType == dstType) {
+        memcpy(dst, src, count*getComponentSize(srcType));
+    }
+    else if (srcType == ImageComponentType::U8 && dstType == ImageComponentType::U16) {
+        const uint8_t *srcData = static_cast<const uint8_t*>(src);
+        uint16_t *dstData = static_cast<uint16_t*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            dstData[i] = static_cast<uint16_t>(srcData[i]*257);
+        }
+    }
+    else if (srcType == ImageComponentType::U16 && dstType == ImageComponentType::U8) {
+        // Keep the high byte like stb_image does for 16-bit files loaded as 8-bit
+        const uint16_t *srcData = static_cast<const uint16_t*>(src);
+        uint8_t *dstData = static_cast<uint8_t*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            dstData[i] = static_cast<uint8_t>(srcData[i] >> 8);
+        }
+    }
+    else if (srcType == ImageComponentType::F32) {
+        convertFromF32(static_cast<const float*>(src), dst, dstType, count);
+    }
+    else if (dstType == ImageComponentType::F32) {
+        convertToF32(src, srcType, static_cast<float*>(dst), count);
+    }
+    else {
+        static const size_t batchSize = 1024;
+        float floats[batchSize];
+        const uint8_t *srcData = static_cast<const uint8_t*>(src);
+        uint8_t *dstData = static_cast<uint8_t*>(dst);
+        size_t srcSize = getComponentSize(srcType);
+        size_t dstSize = getComponentSize(dstType);
+        for (size_t i = 0; i < count; i += batchSize) {
+            size_t batch = std::min(batchSize, count - i);
+            convertToF32(srcData + i*srcSize, srcType, floats, batch);
+            convertFromF32(floats, dstData + i*dstSize, dstType, batch);
+        }
+    }
 }
 
 void Image::destroy() {
     mData.clear();
+    mMipOffsets.clear();
     mSize = glm::ivec2(0, 0);
     mFmt = ImageFormat::None;
+    mType = ImageComponentType::None;
 }
 
 const void *Image::getData() const {
@@ -98,6 +731,10 @@ void *Image::getData() {
     return mData.data();
 }
 
+size_t Image::getDataSize() const {
+    return mData.size();
+}
+
 const glm::ivec2 &Image::getSize() const {
     return mSize;
 }
@@ -106,8 +743,247 @@ ImageFormat Image::getFormat() const {
     return mFmt;
 }
 
+ImageComponentType Image::getComponentType() const {
+    return mType;
+}
+
+size_t Image::getPixelSize() const {
+    return static_cast<size_t>(mFmt)*getComponentSize(mType);
+}
+
 const std::string &Image::getPath() const {
     return mPath;
 }
 
+size_t Image::getMipCount() const {
+    return mMipOffsets.size();
+}
+
+const void *Image::getMipData(size_t level) const {
+    HD_ASSERT(level < mMipOffsets.size());
+    return mData.data() + mMipOffsets[level];
+}
+
+void *Image::getMipData(size_t level) {
+    HD_ASSERT(level < mMipOffsets.size());
+    return mData.data() + mMipOffsets[level];
+}
+
+glm::ivec2 Image::getMipSize(size_t level) const {
+    HD_ASSERT(level < mMipOffsets.size());
+    return getLevelSize(mSize, level);
+}
+
+void Image::createFromHDImg(Stream &stream, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) {
+    size_t startPos = stream.tell();
+    HDImgHeader header;
+    if (stream.read(header) != sizeof(header) || header.version != HDImgHeader::VERSION) {
+        HD_LOG_FATAL("Failed to load image from stream '{}'. Error: unsupported HDImg header", stream.getName().data());
+    }
+    if (header.mipCount == 0 || header.mipCount > HDImgHeader::MAX_MIPS || header.width <= 0 || header.height <= 0 ||
+            header.format < static_cast<uint32_t>(ImageFormat::Grey) || header.format > static_cast<uint32_t>(ImageFormat::RGBA) ||
+            header.componentType < static_cast<uint32_t>(ImageComponentType::U8) || header.componentType > static_cast<uint32_t>(ImageComponentType::F32)) {
+        HD_LOG_FATAL("Failed to load image from stream '{}'. Error: corrupted HDImg header", stream.getName().data());
+    }
+    // The pixel data is indexed by the mip offsets, so they must describe exactly the layout this loader expects
+    glm::ivec2 size(header.width, header.height);
+    uint32_t maxMipCount = 1;
+    while ((glm::max(size.x, size.y) >> maxMipCount) > 0) {
+        maxMipCount++;
+    }
+    std::vector<size_t> offsets;
+    size_t pixelSize = static_cast<size_t>(header.format)*getComponentSize(static_cast<ImageComponentType>(header.componentType));
+    bool isLayoutValid = header.mipCount <= maxMipCount && header.dataSize == computeMipLayout(size, pixelSize, header.mipCount, offsets);
+    for (size_t i = 0; isLayoutValid && i < offsets.size(); i++) {
+        isLayoutValid = header.mipOffsets[i] == offsets[i];
+    }
+    if (!isLayoutValid) {
+        HD_LOG_FATAL("Failed to load image from stream '{}'. Error: corrupted HDImg mip layout", stream.getName().data());
+    }
+
+    destroy();
+    mSize = size;
+    mFmt = static_cast<ImageFormat>(header.format);
+    mType = static_cast<ImageComponentType>(header.componentType);
+    mMipOffsets = offsets;
+
+    // Pixels of all levels are stored as one contiguous block, so this is a single read
+    mData.resize(static_cast<size_t>(header.dataSize));
+    if (!stream.seek(startPos + static_cast<size_t>(header.dataOffset)) || stream.read(mData.data(), mData.size()) != mData.size()) {
+        HD_LOG_FATAL("Failed to load image from stream '{}'. Error: unexpected end of HDImg data", stream.getName().data());
+    }
+
+    if (requiredFmt != ImageFormat::None && requiredFmt != mFmt) {
+        convertFormat(requiredFmt);
+    }
+    if (requiredType != ImageComponentType::None && requiredType != mType) {
+        convert(requiredType);
+    }
+    if (flipVertically) {
+        for (size_t i = 0; i < mMipOffsets.size(); i++) {
+            flipRows(mData.data() + mMipOffsets[i], getMipSize(i), getPixelSize());
+        }
+    }
+}
+
+void Image::convertFormat(ImageFormat fmt) {
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> data(computeMipLayout(mSize, static_cast<size_t>(fmt)*getComponentSize(mType), mMipOffsets.size(), offsets));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        glm::ivec2 levelSize = getMipSize(i);
+        convertPixels(mData.data() + mMipOffsets[i], mFmt, data.data() + offsets[i], fmt, static_cast<size_t>(levelSize.x)*static_cast<size_t>(levelSize.y), mType);
+    }
+    mData = std::move(data);
+    mMipOffsets = offsets;
+    mFmt = fmt;
+}
+
+void Image::saveToPNG(Stream &stream) const {
+    static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const uint8_t colorTypes[] = { 0, 0, 4, 2, 6 };
+    static const size_t maxBlockSize = 65535;
+    writeData(stream, signature, sizeof(signature));
+
+    // 16-bit images keep their precision, float ones are clamped to 8-bit
+    ImageComponentType fileType = mType == ImageComponentType::U16 ? ImageComponentType::U16 : ImageComponentType::U8;
+    uint8_t ihdr[13];
+    writeBigEndian32(ihdr, static_cast<uint32_t>(mSize.x));
+    writeBigEndian32(ihdr + 4, static_cast<uint32_t>(mSize.y));
+    ihdr[8] = fileType == ImageComponentType::U16 ? 16 : 8;
+    ihdr[9] = colorTypes[static_cast<int>(mFmt)];
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    writePNGChunk(stream, "IHDR", ihdr, sizeof(ihdr));
+
+    // Scanlines are written without filtering into stored (uncompressed) deflate blocks, one IDAT chunk per block.
+    // This trades file size for encoding speed, use an external optimizer for shipping assets.
+    std::vector<uint8_t> idat;
+    idat.reserve(maxBlockSize + 16);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    std::vector<uint8_t> block;
+    block.reserve(maxBlockSize);
+    uint32_t adlerA = 1, adlerB = 0;
+
+    auto flushBlock = [&](bool isFinal) {
+        uint16_t len = static_cast<uint16_t>(block.size());
+        idat.push_back(isFinal ? 1 : 0);
+        idat.push_back(static_cast<uint8_t>(len));
+        idat.push_back(static_cast<uint8_t>(len >> 8));
+        idat.push_back(static_cast<uint8_t>(~len));
+        idat.push_back(static_cast<uint8_t>(~len >> 8));
+        idat.insert(idat.end(), block.begin(), block.end());
+        if (isFinal) {
+            uint8_t adler[4];
+            writeBigEndian32(adler, (adlerB << 16) | adlerA);
+            idat.insert(idat.end(), adler, adler + 4);
+        }
+        writePNGChunk(stream, "IDAT", idat.data(), idat.size());
+        idat.clear();
+        block.clear();
+    };
+    auto append = [&](const uint8_t *data, size_t size) {
+        while (size > 0) {
+            size_t count = std::min(size, maxBlockSize - block.size());
+            for (size_t i = 0; i < count; i++) {
+                adlerA = (adlerA + data[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+            block.insert(block.end(), data, data + count);
+            data += count;
+            size -= count;
+            if (block.size() == maxBlockSize) {
+                flushBlock(false);
+            }
+        }
+    };
+
+    size_t componentCount = static_cast<size_t>(mSize.x*static_cast<int>(mFmt));
+    size_t srcRowSize = componentCount*getComponentSize(mType);
+    std::vector<uint8_t> row(componentCount*getComponentSize(fileType));
+    for (int y = 0; y < mSize.y; y++) {
+        convertComponents(mData.data() + static_cast<size_t>(y)*srcRowSize, mType, row.data(), fileType, componentCount);
+        if (fileType == ImageComponentType::U16) {
+            // PNG stores samples in big endian
+            for (size_t i = 0; i < row.size(); i += 2) {
+                uint16_t value;
+                memcpy(&value, row.data() + i, sizeof(value));
+                row[i] = static_cast<uint8_t>(value >> 8);
+                row[i + 1] = static_cast<uint8_t>(value);
+            }
+        }
+        uint8_t filter = 0;
+        append(&filter, 1);
+        append(row.data(), row.size());
+    }
+    flushBlock(true);
+    writePNGChunk(stream, "IEND", nullptr, 0);
+}
+
+void Image::saveToTGA(Stream &stream) const {
+    HD_ASSERT(mSize.x <= 0xFFFF && mSize.y <= 0xFFFF);
+
+    // TGA has no grey+alpha truecolor mode, such images are widened to RGBA.
+    // Only 8-bit components are supported, others are converted.
+    ImageFormat fileFmt = mFmt == ImageFormat::GreyAlpha ? ImageFormat::RGBA : mFmt;
+    int bpp = static_cast<int>(fileFmt);
+    bool hasAlpha = fileFmt == ImageFormat::RGBA;
+
+    uint8_t header[18] = {};
+    header[2] = fileFmt == ImageFormat::Grey ? 3 : 2;
+    header[12] = static_cast<uint8_t>(mSize.x);
+    header[13] = static_cast<uint8_t>(mSize.x >> 8);
+    header[14] = static_cast<uint8_t>(mSize.y);
+    header[15] = static_cast<uint8_t>(mSize.y >> 8);
+    header[16] = static_cast<uint8_t>(bpp*8);
+    header[17] = static_cast<uint8_t>((hasAlpha ? 8 : 0) | 0x20); // top-left origin
+    writeData(stream, header, sizeof(header));
+
+    size_t srcComponentCount = static_cast<size_t>(mSize.x*static_cast<int>(mFmt));
+    size_t srcRowSize = srcComponentCount*getComponentSize(mType);
+    size_t rowSize = static_cast<size_t>(mSize.x*bpp);
+    std::vector<uint8_t> srcRow(srcComponentCount);
+    std::vector<uint8_t> row(rowSize);
+    for (int y = 0; y < mSize.y; y++) {
+        convertComponents(mData.data() + static_cast<size_t>(y)*srcRowSize, mType, srcRow.data(), ImageComponentType::U8, srcComponentCount);
+        convertPixels(srcRow.data(), mFmt, row.data(), fileFmt, static_cast<size_t>(mSize.x));
+        if (bpp >= 3) {
+            for (size_t i = 0; i < rowSize; i += static_cast<size_t>(bpp)) {
+                std::swap(row[i], row[i + 2]);
+            }
+        }
+        writeData(stream, row.data(), rowSize);
+    }
+}
+
+void Image::saveToHDImg(Stream &stream) const {
+    const Image *image = this;
+    Image mipmapped;
+    if (getMipCount() == 1) {
+        mipmapped = *this;
+        mipmapped.generateMipmaps();
+        image = &mipmapped;
+    }
+
+    HDImgHeader header = {};
+    header.magic = HDImgHeader::MAGIC;
+    header.version = HDImgHeader::VERSION;
+    header.width = mSize.x;
+    header.height = mSize.y;
+    header.format = static_cast<uint32_t>(mFmt);
+    header.componentType = static_cast<uint32_t>(mType);
+    header.mipCount = static_cast<uint32_t>(image->mMipOffsets.size());
+    header.dataOffset = alignUp(sizeof(HDImgHeader), HDImgHeader::DATA_ALIGNMENT);
+    header.dataSize = image->mData.size();
+    for (size_t i = 0; i < image->mMipOffsets.size(); i++) {
+        header.mipOffsets[i] = image->mMipOffsets[i];
+    }
+
+    uint8_t padding[HDImgHeader::DATA_ALIGNMENT] = {};
+    writeData(stream, &header, sizeof(header));
+    writeData(stream, padding, static_cast<size_t>(header.dataOffset) - sizeof(header));
+    writeData(stream, image->mData.data(), image->mData.size());
+}
+
 }
@@ -13,29 +13,99 @@ enum class ImageFormat {
     RGBA
 };
 
+enum class ImageComponentType {
+    None,
+    U8,
+    U16,
+    F16,
+    F32
+};
+
+enum class ImageFileFormat {
+    PNG,
+    TGA,
+    HDImg
+};
+
+// Layout of the raw .hdimg container: header, then pixel data of all mip levels starting at dataOffset.
+// Every level starts at a 16-byte aligned offset, so the file can be memory mapped and used in place.
+struct HDImgHeader {
+    static const uint32_t MAGIC = 0x4D494448; // "HDIM"
+    static const uint32_t VERSION = 2;
+    static const uint32_t MAX_MIPS = 16;
+    static const uint32_t DATA_ALIGNMENT = 64;
+    static const uint32_t MIP_ALIGNMENT = 16;
+
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint32_t format;
+    uint32_t componentType;
+    uint32_t mipCount;
+    uint32_t reserved;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    uint64_t mipOffsets[MAX_MIPS];
+};
+
+struct ImageInfo {
+    ImageInfo();
+
+    glm::ivec2 size;
+    ImageFormat fmt;
+    ImageComponentType type;
+};
+
 class Image {
 public:
     Image();
-    Image(const void *data, const glm::ivec2 &size, ImageFormat fmt);
-    explicit Image(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false);
-    explicit Image(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false);
+    Image(const void *data, const glm::ivec2 &size, ImageFormat fmt, ImageComponentType type = ImageComponentType::U8);
+    explicit Image(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false, ImageComponentType requiredType = ImageComponentType::U8);
+    explicit Image(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false, ImageComponentType requiredType = ImageComponentType::U8);
     ~Image();
 
-    void create(const void *data, const glm::ivec2 &size, ImageFormat fmt);
-    void create(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false);
-    void create(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false);
+    // requiredType None keeps the native component type of the file: F32 for HDR, U16 for 16-bit files, U8 otherwise
+    void create(const void *data, const glm::ivec2 &size, ImageFormat fmt, ImageComponentType type = ImageComponentType::U8);
+    void create(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false, ImageComponentType requiredType = ImageComponentType::U8);
+    void create(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false, ImageComponentType requiredType = ImageComponentType::U8);
     void destroy();
+    void generateMipmaps();
+    void convert(ImageComponentType type);
+    void save(Stream &stream, ImageFileFormat fileFmt) const;
+    void save(const std::string &path, ImageFileFormat fileFmt) const;
+
+    static ImageInfo probe(Stream &stream);
+    static ImageInfo probe(const std::string &path);
+    static size_t getComponentSize(ImageComponentType type);
+    static void convertPixels(const void *src, ImageFormat srcFmt, void *dst, ImageFormat dstFmt, size_t count, ImageComponentType type = ImageComponentType::U8);
+    static void convertComponents(const void *src, ImageComponentType srcType, void *dst, ImageComponentType dstType, size_t count);
 
     const void *getData() const;
     void *getData();
+    size_t getDataSize() const;
     const glm::ivec2 &getSize() const;
     ImageFormat getFormat() const;
+    ImageComponentType getComponentType() const;
+    size_t getPixelSize() const;
     const std::string &getPath() const;
+    size_t getMipCount() const;
+    const void *getMipData(size_t level) const;
+    void *getMipData(size_t level);
+    glm::ivec2 getMipSize(size_t level) const;
 
 private:
+    void createFromHDImg(Stream &stream, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType);
+    void convertFormat(ImageFormat fmt);
+    void saveToPNG(Stream &stream) const;
+    void saveToTGA(Stream &stream) const;
+    void saveToHDImg(Stream &stream) const;
+
     std::vector<uint8_t> mData;
+    std::vector<size_t> mMipOffsets;
     glm::ivec2 mSize;
     ImageFormat mFmt;
+    ImageComponentType mType;
     std::string mPath;
 };
 
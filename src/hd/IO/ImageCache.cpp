@@ -0,0 +1,165 @@
+#include "ImageCache.hpp"
+#include "FileStream.hpp"
+#include "MemoryStream.hpp"
+#include "../Core/Log.hpp"
+
+namespace hd {
+
+static uint64_t hashBytes(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i])*0x100000001B3ull;
+    }
+    return hash;
+}
+
+// StringHash(const std::string &) registers the string in a global table that isn't thread safe,
+// the cache only needs the value
+static StringHash hashPath(const std::filesystem::path &path) {
+    return StringHash(static_cast<uint64_t>(std::hash<std::string>()(path.string())));
+}
+
+static uint64_t makeKey(uint64_t hash, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) {
+    uint64_t options = (static_cast<uint64_t>(requiredType) << 4) | (static_cast<uint64_t>(requiredFmt) << 1) | (flipVertically ? 1 : 0);
+    return hash ^ ((options + 1)*0x9E3779B97F4A7C15ull);
+}
+
+ImageCache::ImageCache(size_t memoryBudget) {
+    mMemoryBudget = memoryBudget;
+    mMemoryUsage = 0;
+}
+
+ImageCache::~ImageCache() {
+    clear();
+}
+
+std::shared_ptr<const Image> ImageCache::get(const std::string &path, ImageFormat requiredFmt, bool flipVertically, ImageComponentType requiredType) {
+    std::error_code ec;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+        canonicalPath = path;
+    }
+    std::filesystem::file_time_type fileTime = std::filesystem::last_write_time(canonicalPath, ec);
+    uintmax_t fileSize = ec ? 0 : std::filesystem::file_size(canonicalPath, ec);
+    if (ec) {
+        HD_LOG_ERROR("Failed to access image '{}'. Error: {}", path.data(), ec.message().data());
+        return nullptr;
+    }
+
+    StringHash pathHash = hashPath(canonicalPath);
+    uint64_t key = makeKey(pathHash.getHash(), requiredFmt, flipVertically, requiredType);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it != mEntries.end()) {
+            if (it->second.fileTime == fileTime && it->second.fileSize == fileSize) {
+                mLRU.splice(mLRU.begin(), mLRU, it->second.lruIt);
+                return it->second.image;
+            }
+            erase(it);
+        }
+    }
+
+    // Decoding happens outside of the lock, concurrent misses on the same file may decode it twice
+    FileStream fs(canonicalPath.string(), FileMode::Read);
+    MemoryStream ms(fs.readAllBuffer());
+    ms.setName(path);
+    uint64_t contentKey = makeKey(hashBytes(ms.getData(), ms.getSize()), requiredFmt, flipVertically, requiredType);
+
+    std::shared_ptr<const Image> image;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mContents.find(contentKey);
+        if (it != mContents.end()) {
+            image = it->second.lock();
+        }
+    }
+    if (!image) {
+        image = std::make_shared<Image>(ms, requiredFmt, flipVertically, requiredType);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    insert(key, Entry { pathHash, fileTime, fileSize, contentKey, image, {} });
+    mContents[contentKey] = image;
+    evict(key);
+    return image;
+}
+
+void ImageCache::remove(const std::string &path) {
+    std::error_code ec;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+        canonicalPath = path;
+    }
+    StringHash pathHash = hashPath(canonicalPath);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        auto next = std::next(it);
+        if (it->second.path == pathHash) {
+            erase(it);
+        }
+        it = next;
+    }
+}
+
+void ImageCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mContents.clear();
+    mLRU.clear();
+    mMemoryUsage = 0;
+}
+
+void ImageCache::setMemoryBudget(size_t memoryBudget) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMemoryBudget = memoryBudget;
+    evict(0);
+}
+
+size_t ImageCache::getMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMemoryBudget;
+}
+
+size_t ImageCache::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMemoryUsage;
+}
+
+size_t ImageCache::getCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+void ImageCache::insert(uint64_t key, Entry &&entry) {
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        erase(it);
+    }
+    mLRU.push_front(key);
+    entry.lruIt = mLRU.begin();
+    // Entries sharing pixels are accounted separately, so the usage is an upper bound
+    mMemoryUsage += entry.image->getDataSize();
+    mEntries.emplace(key, std::move(entry));
+}
+
+void ImageCache::erase(std::unordered_map<uint64_t, Entry>::iterator it) {
+    uint64_t contentKey = it->second.contentKey;
+    mMemoryUsage -= it->second.image->getDataSize();
+    mLRU.erase(it->second.lruIt);
+    mEntries.erase(it);
+
+    auto contentIt = mContents.find(contentKey);
+    if (contentIt != mContents.end() && contentIt->second.expired()) {
+        mContents.erase(contentIt);
+    }
+}
+
+void ImageCache::evict(uint64_t keepKey) {
+    while (mMemoryUsage > mMemoryBudget && !mLRU.empty() && mLRU.back() != keepKey) {
+        erase(mEntries.find(mLRU.back()));
+    }
+}
+
+}
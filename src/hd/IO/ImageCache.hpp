@@ -0,0 +1,53 @@
+#pragma once
+#include "Image.hpp"
+#include "../Core/StringHash.hpp"
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace hd {
+
+// Shares decoded images between users. Entries are keyed by canonical path and load options and are
+// revalidated against the file modification time and size, files with identical content share pixels.
+// Least recently used entries are dropped once the memory budget is exceeded, images still referenced
+// by users stay alive until released.
+class ImageCache : public Noncopyable {
+public:
+    explicit ImageCache(size_t memoryBudget = 256*1024*1024);
+    ~ImageCache();
+
+    std::shared_ptr<const Image> get(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, bool flipVertically = false,
+        ImageComponentType requiredType = ImageComponentType::U8);
+    void remove(const std::string &path);
+    void clear();
+
+    void setMemoryBudget(size_t memoryBudget);
+    size_t getMemoryBudget() const;
+    size_t getMemoryUsage() const;
+    size_t getCount() const;
+
+private:
+    struct Entry {
+        StringHash path;
+        std::filesystem::file_time_type fileTime;
+        uintmax_t fileSize;
+        uint64_t contentKey;
+        std::shared_ptr<const Image> image;
+        std::list<uint64_t>::iterator lruIt;
+    };
+
+    void insert(uint64_t key, Entry &&entry);
+    void erase(std::unordered_map<uint64_t, Entry>::iterator it);
+    void evict(uint64_t keepKey);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<uint64_t, Entry> mEntries;
+    std::unordered_map<uint64_t, std::weak_ptr<const Image>> mContents;
+    std::list<uint64_t> mLRU;
+    size_t mMemoryBudget;
+    size_t mMemoryUsage;
+};
+
+}
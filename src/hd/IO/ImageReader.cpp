@@ -0,0 +1,970 @@
+#include "ImageReader.hpp"
+#include "FileStream.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace hd {
+
+class ImageRowDecoder {
+public:
+    virtual ~ImageRowDecoder() = default;
+
+    // Decodes the next row in the native format of the file
+    virtual bool decodeRow(uint8_t *data) = 0;
+    virtual bool isStreaming() const { return true; }
+
+    const glm::ivec2 &getSize() const { return mSize; }
+    ImageFormat getFormat() const { return mFmt; }
+    ImageComponentType getComponentType() const { return mType; }
+    size_t getRowSize() const { return static_cast<size_t>(mSize.x*static_cast<int>(mFmt))*Image::getComponentSize(mType); }
+
+protected:
+    glm::ivec2 mSize = glm::ivec2(0, 0);
+    ImageFormat mFmt = ImageFormat::None;
+    ImageComponentType mType = ImageComponentType::U8;
+};
+
+// Streaming zlib/deflate decoder (RFC 1950/1951) that keeps only the 32 KiB history window in memory
+class Inflater {
+public:
+    using ReadFunc = std::function<size_t(uint8_t *data, size_t size)>;
+
+    explicit Inflater(const ReadFunc &readFunc) : mReadFunc(readFunc) {}
+
+    size_t read(uint8_t *data, size_t size) {
+        size_t total = 0;
+        while (total < size) {
+            if (mWritten == mRead) {
+                if (mState == State::Done) {
+                    break;
+                }
+                fill();
+                continue;
+            }
+            size_t count = std::min(static_cast<size_t>(mWritten - mRead), size - total);
+            for (size_t i = 0; i < count; i++) {
+                data[total + i] = mWindow[(mRead + i) & WINDOW_MASK];
+            }
+            mRead += count;
+            total += count;
+        }
+        return total;
+    }
+
+    bool hasError() const {
+        return mHasError;
+    }
+
+private:
+    static const size_t WINDOW_SIZE = 1 << 16;
+    static const size_t WINDOW_MASK = WINDOW_SIZE - 1;
+    static const size_t MAX_HISTORY = 1 << 15;
+    static const int FAST_BITS = 10;
+
+    enum class State {
+        StreamHeader,
+        BlockHeader,
+        Stored,
+        Huffman,
+        Done
+    };
+
+    struct Huffman {
+        uint16_t fast[1 << FAST_BITS];
+        uint16_t counts[16];
+        uint16_t symbols[288];
+    };
+
+    void fill() {
+        while (mWritten - mRead < MAX_HISTORY && mState != State::Done) {
+            if (mMatchLength > 0) {
+                for (; mMatchLength > 0; mMatchLength--, mWritten++) {
+                    mWindow[mWritten & WINDOW_MASK] = mWindow[(mWritten - mMatchDist) & WINDOW_MASK];
+                }
+                continue;
+            }
+            switch (mState) {
+                case State::StreamHeader: {
+                    uint32_t cmf = getBits(8);
+                    uint32_t flg = getBits(8);
+                    if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+                        setError();
+                    }
+                    else {
+                        mState = State::BlockHeader;
+                    }
+                    break;
+                }
+                case State::BlockHeader: {
+                    decodeBlockHeader();
+                    break;
+                }
+                case State::Stored: {
+                    if (mStoredLeft == 0) {
+                        mState = mIsFinalBlock ? State::Done : State::BlockHeader;
+                        break;
+                    }
+                    mWindow[mWritten++ & WINDOW_MASK] = static_cast<uint8_t>(getBits(8));
+                    mStoredLeft--;
+                    break;
+                }
+                case State::Huffman: {
+                    decodeSymbol();
+                    break;
+                }
+                case State::Done: {
+                    break;
+                }
+            }
+        }
+    }
+
+    void decodeBlockHeader() {
+        static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        mIsFinalBlock = getBits(1) != 0;
+        uint32_t type = getBits(2);
+        if (type == 0) {
+            consumeBits(mBitCount & 7);
+            uint32_t len = getBits(16);
+            uint32_t nlen = getBits(16);
+            if (len != (~nlen & 0xFFFF)) {
+                setError();
+                return;
+            }
+            mStoredLeft = len;
+            mState = State::Stored;
+        }
+        else if (type == 1) {
+            uint8_t lengths[288 + 32];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 32);
+            if (!buildHuffman(mLitLen, lengths, 288) || !buildHuffman(mDist, lengths + 288, 30)) {
+                setError();
+                return;
+            }
+            mState = State::Huffman;
+        }
+        else if (type == 2) {
+            uint32_t litLenCount = getBits(5) + 257;
+            uint32_t distCount = getBits(5) + 1;
+            uint32_t codeLenCount = getBits(4) + 4;
+            if (litLenCount > 286 || distCount > 30) {
+                setError();
+                return;
+            }
+
+            uint8_t codeLengths[19] = {};
+            for (uint32_t i = 0; i < codeLenCount; i++) {
+                codeLengths[codeLengthOrder[i]] = static_cast<uint8_t>(getBits(3));
+            }
+            Huffman codeLenHuffman;
+            if (!buildHuffman(codeLenHuffman, codeLengths, 19)) {
+                setError();
+                return;
+            }
+
+            uint8_t lengths[288 + 32] = {};
+            uint32_t count = 0;
+            while (count < litLenCount + distCount) {
+                int symbol = decode(codeLenHuffman);
+                if (symbol < 0) {
+                    setError();
+                    return;
+                }
+                if (symbol < 16) {
+                    lengths[count++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                uint8_t value = 0;
+                uint32_t repeat;
+                if (symbol == 16) {
+                    if (count == 0) {
+                        setError();
+                        return;
+                    }
+                    value = lengths[count - 1];
+                    repeat = 3 + getBits(2);
+                }
+                else if (symbol == 17) {
+                    repeat = 3 + getBits(3);
+                }
+                else {
+                    repeat = 11 + getBits(7);
+                }
+                if (count + repeat > litLenCount + distCount) {
+                    setError();
+                    return;
+                }
+                for (; repeat > 0; repeat--) {
+                    lengths[count++] = value;
+                }
+            }
+            if (lengths[256] == 0 || !buildHuffman(mLitLen, lengths, static_cast<int>(litLenCount)) ||
+                    !buildHuffman(mDist, lengths + litLenCount, static_cast<int>(distCount))) {
+                setError();
+                return;
+            }
+            mState = State::Huffman;
+        }
+        else {
+            setError();
+        }
+    }
+
+    void decodeSymbol() {
+        static const uint16_t lengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+        };
+        static const uint8_t lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+        static const uint16_t distBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+        };
+        static const uint8_t distExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+
+        int symbol = decode(mLitLen);
+        if (symbol < 0) {
+            setError();
+        }
+        else if (symbol < 256) {
+            mWindow[mWritten++ & WINDOW_MASK] = static_cast<uint8_t>(symbol);
+        }
+        else if (symbol == 256) {
+            mState = mIsFinalBlock ? State::Done : State::BlockHeader;
+        }
+        else {
+            symbol -= 257;
+            if (symbol >= 29) {
+                setError();
+                return;
+            }
+            uint32_t length = lengthBase[symbol] + getBits(lengthExtra[symbol]);
+            int distSymbol = decode(mDist);
+            if (distSymbol < 0 || distSymbol >= 30) {
+                setError();
+                return;
+            }
+            uint32_t dist = distBase[distSymbol] + getBits(distExtra[distSymbol]);
+            if (dist > mWritten) {
+                setError();
+                return;
+            }
+            mMatchLength = length;
+            mMatchDist = dist;
+        }
+    }
+
+    static bool buildHuffman(Huffman &huffman, const uint8_t *lengths, int count) {
+        memset(huffman.counts, 0, sizeof(huffman.counts));
+        memset(huffman.fast, 0, sizeof(huffman.fast));
+        for (int i = 0; i < count; i++) {
+            huffman.counts[lengths[i]]++;
+        }
+        huffman.counts[0] = 0;
+
+        // Over-subscribed codes are invalid, incomplete ones are allowed by the format
+        int left = 1;
+        for (int len = 1; len < 16; len++) {
+            left = (left << 1) - huffman.counts[len];
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        uint16_t offsets[16];
+        uint32_t nextCode[16];
+        offsets[1] = 0;
+        nextCode[1] = 0;
+        for (int len = 1; len < 15; len++) {
+            offsets[len + 1] = static_cast<uint16_t>(offsets[len] + huffman.counts[len]);
+            nextCode[len + 1] = (nextCode[len] + huffman.counts[len]) << 1;
+        }
+        for (int i = 0; i < count; i++) {
+            int len = lengths[i];
+            if (len == 0) {
+                continue;
+            }
+            huffman.symbols[offsets[len]++] = static_cast<uint16_t>(i);
+
+            uint32_t code = nextCode[len]++;
+            if (len <= FAST_BITS) {
+                uint32_t reversed = 0;
+                for (int b = 0; b < len; b++) {
+                    reversed |= ((code >> b) & 1) << (len - 1 - b);
+                }
+                for (uint32_t j = reversed; j < (1u << FAST_BITS); j += 1u << len) {
+                    huffman.fast[j] = static_cast<uint16_t>((i << 4) | len);
+                }
+            }
+        }
+        return true;
+    }
+
+    int decode(const Huffman &huffman) {
+        ensureBits(15);
+        uint16_t entry = huffman.fast[mBitBuffer & ((1u << FAST_BITS) - 1)];
+        if (entry) {
+            consumeBits(entry & 15);
+            return entry >> 4;
+        }
+
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; len++) {
+            code |= static_cast<int>(getBits(1));
+            int count = huffman.counts[len];
+            if (code - count < first) {
+                return huffman.symbols[index + (code - first)];
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    void ensureBits(int count) {
+        while (mBitCount < count) {
+            if (mInputPos == mInputSize) {
+                mInputSize = mReadFunc(mInput, sizeof(mInput));
+                mInputPos = 0;
+                if (mInputSize == 0) {
+                    // Pad with zeros so a truncated stream can still be drained, it is reported only if the bits are used
+                    mPaddingBits += 8;
+                    mBitCount += 8;
+                    continue;
+                }
+            }
+            mBitBuffer |= static_cast<uint64_t>(mInput[mInputPos++]) << mBitCount;
+            mBitCount += 8;
+        }
+    }
+
+    uint32_t getBits(int count) {
+        if (count == 0) {
+            return 0;
+        }
+        ensureBits(count);
+        uint32_t value = static_cast<uint32_t>(mBitBuffer & ((1ull << count) - 1));
+        consumeBits(count);
+        return value;
+    }
+
+    void consumeBits(int count) {
+        mBitBuffer >>= count;
+        mBitCount -= count;
+        if (mPaddingBits > mBitCount) {
+            setError();
+        }
+    }
+
+    void setError() {
+        mHasError = true;
+        mState = State::Done;
+        mMatchLength = 0;
+    }
+
+    ReadFunc mReadFunc;
+    uint8_t mInput[1 << 14];
+    size_t mInputPos = 0;
+    size_t mInputSize = 0;
+    uint64_t mBitBuffer = 0;
+    int mBitCount = 0;
+    int mPaddingBits = 0;
+
+    uint8_t mWindow[WINDOW_SIZE];
+    uint64_t mWritten = 0;
+    uint64_t mRead = 0;
+
+    State mState = State::StreamHeader;
+    bool mIsFinalBlock = false;
+    bool mHasError = false;
+    uint32_t mStoredLeft = 0;
+    uint32_t mMatchLength = 0;
+    uint32_t mMatchDist = 0;
+    Huffman mLitLen;
+    Huffman mDist;
+};
+
+static uint32_t readBigEndian32(const uint8_t *data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+class PNGRowDecoder : public ImageRowDecoder {
+public:
+    PNGRowDecoder() {
+        for (int i = 0; i < 256; i++) {
+            mPalette[i*4 + 3] = 255;
+        }
+    }
+
+    // Returns false if the image can't be streamed (interlaced, unusual bit depth, etc.)
+    bool create(Stream &stream) {
+        mStream = &stream;
+
+        uint8_t signature[8];
+        uint8_t chunk[8];
+        uint8_t ihdr[13];
+        if (stream.read(signature, sizeof(signature)) != sizeof(signature) ||
+                stream.read(chunk, sizeof(chunk)) != sizeof(chunk) || memcmp(chunk + 4, "IHDR", 4) != 0 ||
+                stream.read(ihdr, sizeof(ihdr)) != sizeof(ihdr)) {
+            return false;
+        }
+        stream.seek(stream.tell() + 4);
+
+        mSize = glm::ivec2(static_cast<int>(readBigEndian32(ihdr)), static_cast<int>(readBigEndian32(ihdr + 4)));
+        mBitDepth = ihdr[8];
+        mColorType = ihdr[9];
+        uint8_t interlace = ihdr[12];
+        if (mSize.x <= 0 || mSize.y <= 0 || interlace != 0 || ihdr[10] != 0 || ihdr[11] != 0) {
+            return false;
+        }
+
+        switch (mColorType) {
+            case 0: {
+                mChannels = 1;
+                mFmt = ImageFormat::Grey;
+                break;
+            }
+            case 2: {
+                mChannels = 3;
+                mFmt = ImageFormat::RGB;
+                break;
+            }
+            case 3: {
+                mChannels = 1;
+                mFmt = ImageFormat::RGB;
+                break;
+            }
+            case 4: {
+                mChannels = 2;
+                mFmt = ImageFormat::GreyAlpha;
+                break;
+            }
+            case 6: {
+                mChannels = 4;
+                mFmt = ImageFormat::RGBA;
+                break;
+            }
+            default: {
+                return false;
+            }
+        }
+        bool isLowDepth = mBitDepth == 1 || mBitDepth == 2 || mBitDepth == 4;
+        if (!(mBitDepth == 8 || (mBitDepth == 16 && mColorType != 3) || (isLowDepth && (mColorType == 0 || mColorType == 3)))) {
+            return false;
+        }
+        mType = mBitDepth == 16 ? ImageComponentType::U16 : ImageComponentType::U8;
+
+        // Walk the ancillary chunks up to the first IDAT
+        while (true) {
+            if (stream.read(chunk, sizeof(chunk)) != sizeof(chunk)) {
+                return false;
+            }
+            uint32_t length = readBigEndian32(chunk);
+            if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+                mChunkLeft = length;
+                break;
+            }
+            else if (memcmp(chunk + 4, "PLTE", 4) == 0) {
+                if (length > sizeof(mPalette) / 4*3 || length % 3 != 0) {
+                    return false;
+                }
+                uint8_t palette[256*3];
+                if (stream.read(palette, length) != length) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < length / 3; i++) {
+                    mPalette[i*4 + 0] = palette[i*3 + 0];
+                    mPalette[i*4 + 1] = palette[i*3 + 1];
+                    mPalette[i*4 + 2] = palette[i*3 + 2];
+                }
+                stream.seek(stream.tell() + 4);
+            }
+            else if (memcmp(chunk + 4, "tRNS", 4) == 0) {
+                // Color-keyed transparency of non-palette images is left to the full decoder
+                if (mColorType != 3 || length > 256) {
+                    return false;
+                }
+                uint8_t alpha[256];
+                if (stream.read(alpha, length) != length) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < length; i++) {
+                    mPalette[i*4 + 3] = alpha[i];
+                }
+                mFmt = ImageFormat::RGBA;
+                stream.seek(stream.tell() + 4);
+            }
+            else if (memcmp(chunk + 4, "IEND", 4) == 0) {
+                return false;
+            }
+            else {
+                stream.seek(stream.tell() + length + 4);
+            }
+        }
+
+        mPixelBytes = std::max<size_t>(1, static_cast<size_t>(mChannels*mBitDepth / 8));
+        mFilteredRowSize = (static_cast<size_t>(mSize.x)*static_cast<size_t>(mChannels*mBitDepth) + 7) / 8;
+        mPrevRow.assign(mFilteredRowSize + 1, 0);
+        mRow.resize(mFilteredRowSize + 1);
+        mInflater = std::make_unique<Inflater>([this](uint8_t *data, size_t size) { return readIDAT(data, size); });
+        return true;
+    }
+
+    bool decodeRow(uint8_t *data) override {
+        if (mInflater->read(mRow.data(), mRow.size()) != mRow.size()) {
+            return false;
+        }
+        if (!unfilter(mRow[0], mRow.data() + 1, mPrevRow.data() + 1)) {
+            return false;
+        }
+        expand(mRow.data() + 1, data);
+        std::swap(mPrevRow, mRow);
+        return true;
+    }
+
+private:
+    size_t readIDAT(uint8_t *data, size_t size) {
+        while (mChunkLeft == 0) {
+            // Skip CRC and continue with the next chunk if it is IDAT too
+            uint8_t chunk[8];
+            mStream->seek(mStream->tell() + 4);
+            if (mStream->read(chunk, sizeof(chunk)) != sizeof(chunk) || memcmp(chunk + 4, "IDAT", 4) != 0) {
+                return 0;
+            }
+            mChunkLeft = readBigEndian32(chunk);
+        }
+        size_t count = mStream->read(data, std::min(size, static_cast<size_t>(mChunkLeft)));
+        mChunkLeft -= static_cast<uint32_t>(count);
+        return count;
+    }
+
+    bool unfilter(uint8_t filter, uint8_t *row, const uint8_t *prev) const {
+        size_t bpp = mPixelBytes;
+        switch (filter) {
+            case 0: {
+                break;
+            }
+            case 1: {
+                for (size_t i = bpp; i < mFilteredRowSize; i++) {
+                    row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+                }
+                break;
+            }
+            case 2: {
+                for (size_t i = 0; i < mFilteredRowSize; i++) {
+                    row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+                }
+                break;
+            }
+            case 3: {
+                for (size_t i = 0; i < mFilteredRowSize; i++) {
+                    int left = i >= bpp ? row[i - bpp] : 0;
+                    row[i] = static_cast<uint8_t>(row[i] + ((left + prev[i]) >> 1));
+                }
+                break;
+            }
+            case 4: {
+                for (size_t i = 0; i < mFilteredRowSize; i++) {
+                    int a = i >= bpp ? row[i - bpp] : 0;
+                    int b = prev[i];
+                    int c = i >= bpp ? prev[i - bpp] : 0;
+                    int p = a + b - c;
+                    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                    row[i] = static_cast<uint8_t>(row[i] + predictor);
+                }
+                break;
+            }
+            default: {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void expand(const uint8_t *src, uint8_t *dst) const {
+        size_t width = static_cast<size_t>(mSize.x);
+        if (mBitDepth == 16) {
+            // Samples are big endian in the file
+            uint16_t *samples = reinterpret_cast<uint16_t*>(dst);
+            for (size_t i = 0; i < width*static_cast<size_t>(mChannels); i++) {
+                samples[i] = static_cast<uint16_t>((src[i*2] << 8) | src[i*2 + 1]);
+            }
+            return;
+        }
+        if (mBitDepth == 8 && mColorType != 3) {
+            memcpy(dst, src, width*static_cast<size_t>(mChannels));
+            return;
+        }
+
+        static const uint8_t greyScale[9] = { 0, 255, 85, 0, 17, 0, 0, 0, 1 };
+        int bpp = static_cast<int>(mFmt);
+        uint32_t mask = (1u << mBitDepth) - 1;
+        for (size_t x = 0; x < width; x++) {
+            size_t bit = x*mBitDepth;
+            uint32_t value = (src[bit / 8] >> (8 - mBitDepth - bit % 8)) & mask;
+            if (mColorType == 3) {
+                memcpy(dst + x*static_cast<size_t>(bpp), mPalette + value*4, static_cast<size_t>(bpp));
+            }
+            else {
+                dst[x] = static_cast<uint8_t>(value*greyScale[mBitDepth]);
+            }
+        }
+    }
+
+    Stream *mStream = nullptr;
+    std::unique_ptr<Inflater> mInflater;
+    std::vector<uint8_t> mRow, mPrevRow;
+    uint8_t mPalette[256*4] = {};
+    uint32_t mChunkLeft = 0;
+    size_t mFilteredRowSize = 0;
+    size_t mPixelBytes = 0;
+    int mChannels = 0;
+    int mBitDepth = 0;
+    int mColorType = 0;
+};
+
+class TGARowDecoder : public ImageRowDecoder {
+public:
+    // Returns false if the image can't be streamed (color mapped, 16-bit, bottom-up RLE, etc.)
+    bool create(Stream &stream) {
+        mStream = &stream;
+
+        uint8_t header[18];
+        if (stream.read(header, sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+        uint8_t type = header[2];
+        int bits = header[16];
+        uint8_t descriptor = header[17];
+        mSize = glm::ivec2(header[12] | (header[13] << 8), header[14] | (header[15] << 8));
+        mIsRLE = type == 10 || type == 11;
+        mIsTopDown = (descriptor & 0x20) != 0;
+        if (header[1] != 0 || mSize.x <= 0 || mSize.y <= 0 || (descriptor & 0x10) || (!mIsTopDown && mIsRLE)) {
+            return false;
+        }
+        if ((type == 3 || type == 11) && bits == 8) {
+            mFmt = ImageFormat::Grey;
+        }
+        else if ((type == 2 || type == 10) && (bits == 24 || bits == 32)) {
+            mFmt = bits == 32 ? ImageFormat::RGBA : ImageFormat::RGB;
+        }
+        else {
+            return false;
+        }
+
+        mDataPos = stream.tell() + header[0];
+        stream.seek(mDataPos);
+        return true;
+    }
+
+    bool decodeRow(uint8_t *data) override {
+        size_t rowSize = getRowSize();
+        int bpp = static_cast<int>(mFmt);
+        if (!mIsRLE) {
+            if (!mIsTopDown && !mStream->seek(mDataPos + static_cast<size_t>(mSize.y - 1 - mRow)*rowSize)) {
+                return false;
+            }
+            if (mStream->read(data, rowSize) != rowSize) {
+                return false;
+            }
+        }
+        else {
+            for (int x = 0; x < mSize.x; x++) {
+                if (mPacketLeft == 0) {
+                    uint8_t packet;
+                    if (mStream->read(packet) != sizeof(packet)) {
+                        return false;
+                    }
+                    mPacketLeft = (packet & 0x7F) + 1;
+                    mIsRunPacket = (packet & 0x80) != 0;
+                    if (mIsRunPacket && mStream->read(mRunPixel, static_cast<size_t>(bpp)) != static_cast<size_t>(bpp)) {
+                        return false;
+                    }
+                }
+                uint8_t *pixel = data + x*bpp;
+                if (mIsRunPacket) {
+                    memcpy(pixel, mRunPixel, static_cast<size_t>(bpp));
+                }
+                else if (mStream->read(pixel, static_cast<size_t>(bpp)) != static_cast<size_t>(bpp)) {
+                    return false;
+                }
+                mPacketLeft--;
+            }
+        }
+        if (bpp >= 3) {
+            for (size_t i = 0; i < rowSize; i += static_cast<size_t>(bpp)) {
+                std::swap(data[i], data[i + 2]);
+            }
+        }
+        mRow++;
+        return true;
+    }
+
+private:
+    Stream *mStream = nullptr;
+    size_t mDataPos = 0;
+    int mRow = 0;
+    bool mIsRLE = false;
+    bool mIsTopDown = false;
+    int mPacketLeft = 0;
+    bool mIsRunPacket = false;
+    uint8_t mRunPixel[4] = {};
+};
+
+class HDImgRowDecoder : public ImageRowDecoder {
+public:
+    bool create(Stream &stream) {
+        mStream = &stream;
+
+        size_t startPos = stream.tell();
+        HDImgHeader header;
+        if (stream.read(header) != sizeof(header) || header.version != HDImgHeader::VERSION || header.mipCount == 0 ||
+                header.width <= 0 || header.height <= 0 ||
+                header.format < static_cast<uint32_t>(ImageFormat::Grey) || header.format > static_cast<uint32_t>(ImageFormat::RGBA) ||
+                header.componentType < static_cast<uint32_t>(ImageComponentType::U8) || header.componentType > static_cast<uint32_t>(ImageComponentType::F32)) {
+            return false;
+        }
+        mSize = glm::ivec2(header.width, header.height);
+        mFmt = static_cast<ImageFormat>(header.format);
+        mType = static_cast<ImageComponentType>(header.componentType);
+        return stream.seek(startPos + static_cast<size_t>(header.dataOffset + header.mipOffsets[0]));
+    }
+
+    bool decodeRow(uint8_t *data) override {
+        return mStream->read(data, getRowSize()) == getRowSize();
+    }
+
+private:
+    Stream *mStream = nullptr;
+};
+
+class FallbackRowDecoder : public ImageRowDecoder {
+public:
+    void create(Stream &stream) {
+        mImage.create(stream, ImageFormat::None, false, ImageComponentType::None);
+        mSize = mImage.getSize();
+        mFmt = mImage.getFormat();
+        mType = mImage.getComponentType();
+    }
+
+    bool decodeRow(uint8_t *data) override {
+        memcpy(data, static_cast<const uint8_t*>(mImage.getData()) + static_cast<size_t>(mRow++)*getRowSize(), getRowSize());
+        return true;
+    }
+
+    bool isStreaming() const override {
+        return false;
+    }
+
+private:
+    Image mImage;
+    int mRow = 0;
+};
+
+ImageReader::ImageReader() : mSize(0, 0) {
+    mFmt = ImageFormat::None;
+    mType = ImageComponentType::None;
+    mCurrentRow = 0;
+}
+
+ImageReader::ImageReader(Stream &stream, ImageFormat requiredFmt, ImageComponentType requiredType) : ImageReader() {
+    create(stream, requiredFmt, requiredType);
+}
+
+ImageReader::ImageReader(const std::string &path, ImageFormat requiredFmt, ImageComponentType requiredType) : ImageReader() {
+    create(path, requiredFmt, requiredType);
+}
+
+ImageReader::~ImageReader() {
+    destroy();
+}
+
+void ImageReader::create(Stream &stream, ImageFormat requiredFmt, ImageComponentType requiredType) {
+    HD_ASSERT(stream.isReadable());
+    // Keep the owned stream alive when called from create(path)
+    if (mFileStream.get() != &stream) {
+        destroy();
+    }
+    mDecoder.reset();
+    mRowBuffer.clear();
+    mConvertBuffer.clear();
+
+    size_t startPos = stream.tell();
+    uint8_t magic[8] = {};
+    stream.read(magic, sizeof(magic));
+    stream.seek(startPos);
+
+    static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint32_t hdimgMagic = HDImgHeader::MAGIC;
+    if (memcmp(magic, pngSignature, sizeof(pngSignature)) == 0) {
+        auto decoder = std::make_unique<PNGRowDecoder>();
+        if (decoder->create(stream)) {
+            mDecoder = std::move(decoder);
+        }
+    }
+    else if (memcmp(magic, &hdimgMagic, sizeof(hdimgMagic)) == 0) {
+        auto decoder = std::make_unique<HDImgRowDecoder>();
+        if (decoder->create(stream)) {
+            mDecoder = std::move(decoder);
+        }
+    }
+    else {
+        auto decoder = std::make_unique<TGARowDecoder>();
+        if (decoder->create(stream)) {
+            mDecoder = std::move(decoder);
+        }
+    }
+
+    if (!mDecoder) {
+        stream.seek(startPos);
+        auto decoder = std::make_unique<FallbackRowDecoder>();
+        decoder->create(stream);
+        mDecoder = std::move(decoder);
+    }
+
+    mSize = mDecoder->getSize();
+    mFmt = requiredFmt != ImageFormat::None ? requiredFmt : mDecoder->getFormat();
+    mType = requiredType != ImageComponentType::None ? requiredType : mDecoder->getComponentType();
+    mCurrentRow = 0;
+    if (mFmt != mDecoder->getFormat() || mType != mDecoder->getComponentType()) {
+        mRowBuffer.resize(mDecoder->getRowSize());
+    }
+    if (mFmt != mDecoder->getFormat() && mType != mDecoder->getComponentType()) {
+        mConvertBuffer.resize(static_cast<size_t>(mSize.x*static_cast<int>(mDecoder->getFormat()))*Image::getComponentSize(mType));
+    }
+}
+
+void ImageReader::create(const std::string &path, ImageFormat requiredFmt, ImageComponentType requiredType) {
+    destroy();
+    mFileStream = std::make_unique<FileStream>(path, FileMode::Read);
+    create(*mFileStream, requiredFmt, requiredType);
+}
+
+void ImageReader::destroy() {
+    mDecoder.reset();
+    mFileStream.reset();
+    mRowBuffer.clear();
+    mConvertBuffer.clear();
+    mSize = glm::ivec2(0, 0);
+    mFmt = ImageFormat::None;
+    mType = ImageComponentType::None;
+    mCurrentRow = 0;
+}
+
+int ImageReader::readRows(void *data, int maxRows) {
+    HD_ASSERT(mDecoder != nullptr);
+
+    uint8_t *dst = static_cast<uint8_t*>(data);
+    int rowCount = 0;
+    for (; rowCount < maxRows && mCurrentRow < mSize.y; rowCount++, mCurrentRow++, dst += getRowSize()) {
+        bool isDecoded;
+        if (mRowBuffer.empty()) {
+            isDecoded = mDecoder->decodeRow(dst);
+        }
+        else {
+            isDecoded = mDecoder->decodeRow(mRowBuffer.data());
+            convertRow(mRowBuffer.data(), dst);
+        }
+        if (!isDecoded) {
+            HD_LOG_ERROR("Failed to decode row {} of image", mCurrentRow);
+            mCurrentRow = mSize.y;
+            break;
+        }
+    }
+    return rowCount;
+}
+
+void ImageReader::readRows(int rowsPerBatch, const ImageRowsCallback &callback) {
+    HD_ASSERT(rowsPerBatch > 0);
+
+    std::vector<uint8_t> rows(static_cast<size_t>(rowsPerBatch)*getRowSize());
+    while (mCurrentRow < mSize.y) {
+        int firstRow = mCurrentRow;
+        int rowCount = readRows(rows.data(), rowsPerBatch);
+        if (rowCount == 0) {
+            break;
+        }
+        callback(rows.data(), firstRow, rowCount);
+    }
+}
+
+void ImageReader::readTiles(const glm::ivec2 &tileSize, const ImageTileCallback &callback) {
+    HD_ASSERT(tileSize.x > 0 && tileSize.y > 0);
+
+    // Only one band of tile rows is kept in memory, and the tile image is reused between callbacks
+    size_t rowSize = getRowSize();
+    size_t bpp = static_cast<size_t>(mFmt)*Image::getComponentSize(mType);
+    std::vector<uint8_t> band(static_cast<size_t>(tileSize.y)*rowSize);
+    Image tile;
+    while (mCurrentRow < mSize.y) {
+        int firstRow = mCurrentRow;
+        int rowCount = readRows(band.data(), tileSize.y);
+        if (rowCount == 0) {
+            break;
+        }
+        for (int x = 0; x < mSize.x; x += tileSize.x) {
+            glm::ivec2 size(std::min(tileSize.x, mSize.x - x), rowCount);
+            tile.create(nullptr, size, mFmt, mType);
+            uint8_t *dst = static_cast<uint8_t*>(tile.getData());
+            size_t tileRowSize = static_cast<size_t>(size.x)*bpp;
+            for (int y = 0; y < rowCount; y++) {
+                memcpy(dst + static_cast<size_t>(y)*tileRowSize, band.data() + static_cast<size_t>(y)*rowSize + static_cast<size_t>(x)*bpp, tileRowSize);
+            }
+            callback(tile, glm::ivec2(x, firstRow));
+        }
+    }
+}
+
+const glm::ivec2 &ImageReader::getSize() const {
+    return mSize;
+}
+
+ImageFormat ImageReader::getFormat() const {
+    return mFmt;
+}
+
+ImageComponentType ImageReader::getComponentType() const {
+    return mType;
+}
+
+size_t ImageReader::getRowSize() const {
+    return static_cast<size_t>(mSize.x*static_cast<int>(mFmt))*Image::getComponentSize(mType);
+}
+
+int ImageReader::getCurrentRow() const {
+    return mCurrentRow;
+}
+
+bool ImageReader::isStreaming() const {
+    return mDecoder && mDecoder->isStreaming();
+}
+
+void ImageReader::convertRow(const uint8_t *src, uint8_t *dst) {
+    size_t width = static_cast<size_t>(mSize.x);
+    ImageFormat srcFmt = mDecoder->getFormat();
+    ImageComponentType srcType = mDecoder->getComponentType();
+    if (srcType == mType) {
+        Image::convertPixels(src, srcFmt, dst, mFmt, width, mType);
+    }
+    else if (srcFmt == mFmt) {
+        Image::convertComponents(src, srcType, dst, mType, width*static_cast<size_t>(mFmt));
+    }
+    else {
+        Image::convertComponents(src, srcType, mConvertBuffer.data(), mType, width*static_cast<size_t>(srcFmt));
+        Image::convertPixels(mConvertBuffer.data(), srcFmt, dst, mFmt, width, mType);
+    }
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Image.hpp"
+#include <functional>
+#include <memory>
+
+namespace hd {
+
+class FileStream;
+class ImageRowDecoder;
+
+using ImageRowsCallback = std::function<void(const void *rows, int firstRow, int rowCount)>;
+using ImageTileCallback = std::function<void(const Image &tile, const glm::ivec2 &tilePos)>;
+
+// Decodes an image top to bottom in small batches of rows, so only a few rows are kept in memory at once.
+// Non-interlaced PNG, TGA and HDImg are decoded progressively, other formats fall back to a full decode.
+class ImageReader : public Noncopyable {
+public:
+    ImageReader();
+    explicit ImageReader(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, ImageComponentType requiredType = ImageComponentType::U8);
+    explicit ImageReader(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, ImageComponentType requiredType = ImageComponentType::U8);
+    ~ImageReader();
+
+    void create(Stream &stream, ImageFormat requiredFmt = ImageFormat::None, ImageComponentType requiredType = ImageComponentType::U8);
+    void create(const std::string &path, ImageFormat requiredFmt = ImageFormat::None, ImageComponentType requiredType = ImageComponentType::U8);
+    void destroy();
+
+    int readRows(void *data, int maxRows);
+    void readRows(int rowsPerBatch, const ImageRowsCallback &callback);
+    void readTiles(const glm::ivec2 &tileSize, const ImageTileCallback &callback);
+
+    const glm::ivec2 &getSize() const;
+    ImageFormat getFormat() const;
+    ImageComponentType getComponentType() const;
+    size_t getRowSize() const;
+    int getCurrentRow() const;
+    bool isStreaming() const;
+
+private:
+    void convertRow(const uint8_t *src, uint8_t *dst);
+
+    std::unique_ptr<FileStream> mFileStream;
+    std::unique_ptr<ImageRowDecoder> mDecoder;
+    std::vector<uint8_t> mRowBuffer;
+    std::vector<uint8_t> mConvertBuffer;
+    glm::ivec2 mSize;
+    ImageFormat mFmt;
+    ImageComponentType mType;
+    int mCurrentRow;
+};
+
+}
@@ -0,0 +1,113 @@
+#include "MemoryStream.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace hd {
+
+MemoryStream::MemoryStream() {
+    mData = nullptr;
+    mSize = 0;
+    mPos = 0;
+    mIsOwned = false;
+    mIsEOF = false;
+}
+
+MemoryStream::MemoryStream(const void *data, size_t size) : MemoryStream() {
+    create(data, size);
+}
+
+MemoryStream::MemoryStream(std::vector<uint8_t> &&buffer) : MemoryStream() {
+    create(std::move(buffer));
+}
+
+MemoryStream::~MemoryStream() {
+    destroy();
+}
+
+size_t MemoryStream::read(void *data, size_t size) {
+    HD_ASSERT(isReadable());
+    size_t count = std::min(size, mSize - std::min(mPos, mSize));
+    if (count > 0) {
+        memcpy(data, mData + mPos, count);
+    }
+    mPos += count;
+    mIsEOF = count < size;
+    return count;
+}
+
+size_t MemoryStream::write(const void *data, size_t size) {
+    HD_ASSERT(isWritable());
+    if (mPos + size > mBuffer.size()) {
+        mBuffer.resize(mPos + size);
+    }
+    memcpy(mBuffer.data() + mPos, data, size);
+    mPos += size;
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+    return size;
+}
+
+size_t MemoryStream::tell() const {
+    return mPos;
+}
+
+size_t MemoryStream::getSize() const {
+    return mSize;
+}
+
+bool MemoryStream::seek(size_t pos) {
+    if (pos > mSize) {
+        return false;
+    }
+    mPos = pos;
+    mIsEOF = false;
+    return true;
+}
+
+bool MemoryStream::isEOF() const {
+    return mIsEOF;
+}
+
+bool MemoryStream::isReadable() const {
+    return mData != nullptr || mIsOwned;
+}
+
+bool MemoryStream::isWritable() const {
+    return mIsOwned;
+}
+
+void MemoryStream::create(const void *data, size_t size) {
+    destroy();
+    mData = static_cast<const uint8_t*>(data);
+    mSize = size;
+}
+
+void MemoryStream::create(std::vector<uint8_t> &&buffer) {
+    destroy();
+    mBuffer = std::move(buffer);
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+    mIsOwned = true;
+}
+
+void MemoryStream::destroy() {
+    mBuffer.clear();
+    mData = nullptr;
+    mSize = 0;
+    mPos = 0;
+    mIsOwned = false;
+    mIsEOF = false;
+    setName("");
+}
+
+const uint8_t *MemoryStream::getData() const {
+    return mData;
+}
+
+std::vector<uint8_t> &MemoryStream::getBuffer() {
+    HD_ASSERT(mIsOwned);
+    return mBuffer;
+}
+
+}
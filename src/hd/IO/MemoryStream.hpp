@@ -0,0 +1,43 @@
+#pragma once
+#include "Stream.hpp"
+
+namespace hd {
+
+class MemoryStream : public Stream {
+public:
+    MemoryStream();
+    MemoryStream(const void *data, size_t size);
+    explicit MemoryStream(std::vector<uint8_t> &&buffer);
+    ~MemoryStream() override;
+
+    size_t read(void *data, size_t size) override;
+    size_t write(const void *data, size_t size) override;
+    size_t tell() const override;
+    size_t getSize() const override;
+    bool seek(size_t pos) override;
+    bool isEOF() const override;
+    bool isReadable() const override;
+    bool isWritable() const override;
+
+    // Read-only view over external memory, the memory must outlive the stream
+    void create(const void *data, size_t size);
+    // Readable and writable stream over an owned buffer that grows on write
+    void create(std::vector<uint8_t> &&buffer);
+    void destroy();
+
+    const uint8_t *getData() const;
+    std::vector<uint8_t> &getBuffer();
+
+    using Stream::read;
+    using Stream::write;
+
+private:
+    std::vector<uint8_t> mBuffer;
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mPos;
+    bool mIsOwned;
+    bool mIsEOF;
+};
+
+}
@@ -0,0 +1,39 @@
+#include "StreamInputBuffer.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace hd {
+
+StreamInputBuffer::StreamInputBuffer(Stream &stream, size_t bufferSize) : mStream(stream), mBuffer(bufferSize) {
+    HD_ASSERT(bufferSize > 0);
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data());
+}
+
+StreamInputBuffer::int_type StreamInputBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    size_t size = mStream.isEOF() ? 0 : mStream.read(mBuffer.data(), mBuffer.size());
+    setg(mBuffer.data(), mBuffer.data(), mBuffer.data() + size);
+    return size > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
+
+std::streamsize StreamInputBuffer::xsgetn(char *data, std::streamsize size) {
+    // Drain the buffer, then read large requests straight from the stream
+    std::streamsize buffered = std::min<std::streamsize>(size, egptr() - gptr());
+    std::memcpy(data, gptr(), static_cast<size_t>(buffered));
+    gbump(static_cast<int>(buffered));
+    std::streamsize count = buffered;
+    if (count < size) {
+        if (static_cast<size_t>(size - count) >= mBuffer.size()) {
+            count += static_cast<std::streamsize>(mStream.read(data + count, static_cast<size_t>(size - count)));
+        }
+        else {
+            count += std::streambuf::xsgetn(data + count, size - count);
+        }
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Stream.hpp"
+#include <streambuf>
+
+namespace hd {
+
+// std::streambuf that reads a Stream through a fixed size buffer, so std::istream based parsers can consume
+// large streams in chunks instead of loading them into memory first
+class StreamInputBuffer : public std::streambuf, public Noncopyable {
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64*1024;
+
+    explicit StreamInputBuffer(Stream &stream, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char *data, std::streamsize size) override;
+
+private:
+    Stream &mStream;
+    std::vector<char> mBuffer;
+};
+
+}
@@ -0,0 +1,211 @@
+#include "AABBBatch.hpp"
+#include "../Core/Log.hpp"
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+// Writes overlap bits of boxes [first, first + 8) into the low 8 bits of the result
+static HD_FORCEINLINE uint32_t testOverlaps8(const AABBBatch &batch, size_t first, const glm::vec3 &qMin, const glm::vec3 &qMax) {
+#if defined(HD_SIMD_AVX)
+    __m256 overlap = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMaxX() + first), _mm256_set1_ps(qMin.x), _CMP_GE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMinX() + first), _mm256_set1_ps(qMax.x), _CMP_LE_OQ));
+    overlap = _mm256_and_ps(overlap, _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMaxY() + first), _mm256_set1_ps(qMin.y), _CMP_GE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMinY() + first), _mm256_set1_ps(qMax.y), _CMP_LE_OQ)));
+    overlap = _mm256_and_ps(overlap, _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMaxZ() + first), _mm256_set1_ps(qMin.z), _CMP_GE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(batch.getMinZ() + first), _mm256_set1_ps(qMax.z), _CMP_LE_OQ)));
+    return static_cast<uint32_t>(_mm256_movemask_ps(overlap));
+#elif defined(HD_SIMD_SSE2)
+    const __m128 qMinX = _mm_set1_ps(qMin.x), qMinY = _mm_set1_ps(qMin.y), qMinZ = _mm_set1_ps(qMin.z);
+    const __m128 qMaxX = _mm_set1_ps(qMax.x), qMaxY = _mm_set1_ps(qMax.y), qMaxZ = _mm_set1_ps(qMax.z);
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 8; i += 4) {
+        __m128 overlap = _mm_and_ps(
+            _mm_cmpge_ps(_mm_loadu_ps(batch.getMaxX() + first + i), qMinX),
+            _mm_cmple_ps(_mm_loadu_ps(batch.getMinX() + first + i), qMaxX));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(
+            _mm_cmpge_ps(_mm_loadu_ps(batch.getMaxY() + first + i), qMinY),
+            _mm_cmple_ps(_mm_loadu_ps(batch.getMinY() + first + i), qMaxY)));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(
+            _mm_cmpge_ps(_mm_loadu_ps(batch.getMaxZ() + first + i), qMinZ),
+            _mm_cmple_ps(_mm_loadu_ps(batch.getMinZ() + first + i), qMaxZ)));
+        bits |= static_cast<uint32_t>(_mm_movemask_ps(overlap)) << i;
+    }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 8; i++) {
+        size_t j = first + i;
+        bool overlap =
+            batch.getMaxX()[j] >= qMin.x && batch.getMinX()[j] <= qMax.x &&
+            batch.getMaxY()[j] >= qMin.y && batch.getMinY()[j] <= qMax.y &&
+            batch.getMaxZ()[j] >= qMin.z && batch.getMinZ()[j] <= qMax.z;
+        bits |= static_cast<uint32_t>(overlap) << i;
+    }
+    return bits;
+#endif
+}
+
+AABBBatch::AABBBatch() {
+    mCount = 0;
+}
+
+AABBBatch::AABBBatch(const AABB *aabbs, size_t count) : AABBBatch() {
+    create(aabbs, count);
+}
+
+void AABBBatch::create(const AABB *aabbs, size_t count) {
+    destroy();
+    resizePadded(count);
+    mCount = count;
+    for (size_t i = 0; i < count; i++) {
+        set(static_cast<uint32_t>(i), aabbs[i]);
+    }
+}
+
+void AABBBatch::destroy() {
+    mMinX.clear();
+    mMinY.clear();
+    mMinZ.clear();
+    mMaxX.clear();
+    mMaxY.clear();
+    mMaxZ.clear();
+    mCount = 0;
+}
+
+void AABBBatch::reserve(size_t count) {
+    size_t paddedCount = (count + PADDING - 1) / PADDING*PADDING;
+    mMinX.reserve(paddedCount);
+    mMinY.reserve(paddedCount);
+    mMinZ.reserve(paddedCount);
+    mMaxX.reserve(paddedCount);
+    mMaxY.reserve(paddedCount);
+    mMaxZ.reserve(paddedCount);
+}
+
+uint32_t AABBBatch::add(const AABB &aabb) {
+    uint32_t index = static_cast<uint32_t>(mCount);
+    if (mCount == mMinX.size()) {
+        resizePadded(mCount + 1);
+    }
+    mCount++;
+    set(index, aabb);
+    return index;
+}
+
+void AABBBatch::set(uint32_t index, const AABB &aabb) {
+    HD_ASSERT(index < mCount);
+    glm::vec3 aabbMin = aabb.pos - aabb.size;
+    glm::vec3 aabbMax = aabb.pos + aabb.size;
+    mMinX[index] = aabbMin.x;
+    mMinY[index] = aabbMin.y;
+    mMinZ[index] = aabbMin.z;
+    mMaxX[index] = aabbMax.x;
+    mMaxY[index] = aabbMax.y;
+    mMaxZ[index] = aabbMax.z;
+}
+
+void AABBBatch::remove(uint32_t index) {
+    HD_ASSERT(index < mCount);
+    size_t last = mCount - 1;
+    mMinX[index] = mMinX[last];
+    mMinY[index] = mMinY[last];
+    mMinZ[index] = mMinZ[last];
+    mMaxX[index] = mMaxX[last];
+    mMaxY[index] = mMaxY[last];
+    mMaxZ[index] = mMaxZ[last];
+
+    // The freed slot becomes padding again
+    mMinX[last] = mMinY[last] = mMinZ[last] = INFINITY;
+    mMaxX[last] = mMaxY[last] = mMaxZ[last] = -INFINITY;
+    mCount--;
+}
+
+// Slots from the count on are padding, whose empty bounds still pass the test against infinite queries
+static HD_FORCEINLINE uint32_t maskValidBoxes(uint32_t bits, size_t first, size_t count) {
+    return first + AABBBatch::PADDING <= count ? bits : bits & ((1u << (count - first)) - 1);
+}
+
+size_t AABBBatch::queryOverlaps(const AABB &aabb, std::vector<uint32_t> &indices) const {
+    glm::vec3 qMin = aabb.pos - aabb.size;
+    glm::vec3 qMax = aabb.pos + aabb.size;
+    size_t startSize = indices.size();
+    for (size_t i = 0; i < mCount; i += PADDING) {
+        uint32_t bits = maskValidBoxes(testOverlaps8(*this, i, qMin, qMax), i, mCount);
+        while (bits) {
+            indices.push_back(static_cast<uint32_t>(i) + static_cast<uint32_t>(MathUtils::countTrailingZeros(bits)));
+            bits &= bits - 1;
+        }
+    }
+    return indices.size() - startSize;
+}
+
+void AABBBatch::queryOverlaps(const AABB &aabb, std::vector<uint64_t> &mask) const {
+    glm::vec3 qMin = aabb.pos - aabb.size;
+    glm::vec3 qMax = aabb.pos + aabb.size;
+    mask.assign((mCount + 63) / 64, 0);
+    for (size_t i = 0; i < mCount; i += PADDING) {
+        uint64_t bits = maskValidBoxes(testOverlaps8(*this, i, qMin, qMax), i, mCount);
+        if (bits) {
+            mask[i / 64] |= bits << (i % 64);
+        }
+    }
+}
+
+AABB AABBBatch::get(uint32_t index) const {
+    HD_ASSERT(index < mCount);
+    glm::vec3 aabbMin(mMinX[index], mMinY[index], mMinZ[index]);
+    glm::vec3 aabbMax(mMaxX[index], mMaxY[index], mMaxZ[index]);
+    return AABB((aabbMin + aabbMax)*0.5f, (aabbMax - aabbMin)*0.5f);
+}
+
+size_t AABBBatch::getCount() const {
+    return mCount;
+}
+
+size_t AABBBatch::getPaddedCount() const {
+    return mMinX.size();
+}
+
+const float *AABBBatch::getMinX() const {
+    return mMinX.data();
+}
+
+const float *AABBBatch::getMinY() const {
+    return mMinY.data();
+}
+
+const float *AABBBatch::getMinZ() const {
+    return mMinZ.data();
+}
+
+const float *AABBBatch::getMaxX() const {
+    return mMaxX.data();
+}
+
+const float *AABBBatch::getMaxY() const {
+    return mMaxY.data();
+}
+
+const float *AABBBatch::getMaxZ() const {
+    return mMaxZ.data();
+}
+
+void AABBBatch::resizePadded(size_t count) {
+    // Padding boxes are empty (min > max) and fail the overlap test against finite queries,
+    // queries still mask out slots from the count on
+    size_t paddedCount = (count + PADDING - 1) / PADDING*PADDING;
+    mMinX.resize(paddedCount, INFINITY);
+    mMinY.resize(paddedCount, INFINITY);
+    mMinZ.resize(paddedCount, INFINITY);
+    mMaxX.resize(paddedCount, -INFINITY);
+    mMaxY.resize(paddedCount, -INFINITY);
+    mMaxZ.resize(paddedCount, -INFINITY);
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <vector>
+
+namespace hd {
+
+// Structure of arrays storage of boxes as precomputed min/max coordinates, tested against a query box
+// 4 (SSE) or 8 (AVX) boxes at a time. Arrays are padded to a multiple of 8 with empty boxes that never
+// overlap anything, so kernels don't need a scalar tail.
+class AABBBatch {
+public:
+    static const size_t PADDING = 8;
+
+    AABBBatch();
+    AABBBatch(const AABB *aabbs, size_t count);
+
+    void create(const AABB *aabbs, size_t count);
+    void destroy();
+    void reserve(size_t count);
+
+    uint32_t add(const AABB &aabb);
+    void set(uint32_t index, const AABB &aabb);
+    // Moves the last box into the removed slot, so only the index of the last box changes
+    void remove(uint32_t index);
+
+    // Appends indices of the boxes overlapping the given one, touching boxes are considered overlapping
+    // as in AABB::intersectAABB. Returns the number of appended indices.
+    size_t queryOverlaps(const AABB &aabb, std::vector<uint32_t> &indices) const;
+    // Writes one bit per box, bit i of mask[i / 64] is set if box i overlaps
+    void queryOverlaps(const AABB &aabb, std::vector<uint64_t> &mask) const;
+
+    AABB get(uint32_t index) const;
+    size_t getCount() const;
+    size_t getPaddedCount() const;
+    const float *getMinX() const;
+    const float *getMinY() const;
+    const float *getMinZ() const;
+    const float *getMaxX() const;
+    const float *getMaxY() const;
+    const float *getMaxZ() const;
+
+private:
+    void resizePadded(size_t count);
+
+    std::vector<float> mMinX, mMinY, mMinZ;
+    std::vector<float> mMaxX, mMaxY, mMaxZ;
+    size_t mCount;
+};
+
+}
@@ -0,0 +1,384 @@
+#include "BVH.hpp"
+#include "../Core/Log.hpp"
+#include "../Core/Parallel.hpp"
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+namespace hd {
+
+// Nodes with fewer primitives are processed on the calling thread, the pool overhead would dominate
+static const size_t PARALLEL_MIN_COUNT = 16384;
+static const size_t PARALLEL_CHUNK_SIZE = 4096;
+// From this depth on the SAH split is replaced by a median split, which bounds the tree depth by MAX_DEPTH
+static const size_t MEDIAN_SPLIT_DEPTH = BVH::MAX_DEPTH - 32;
+
+struct BVHBin {
+    BVHBin() : min(INFINITY), max(-INFINITY) {
+        this->count = 0;
+    }
+
+    void grow(const glm::vec3 &primMin, const glm::vec3 &primMax) {
+        min = glm::min(min, primMin);
+        max = glm::max(max, primMax);
+        count++;
+    }
+
+    void grow(const BVHBin &bin) {
+        min = glm::min(min, bin.min);
+        max = glm::max(max, bin.max);
+        count += bin.count;
+    }
+
+    glm::vec3 min, max;
+    size_t count;
+};
+
+static float getHalfArea(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax) {
+    glm::vec3 extent = aabbMax - aabbMin;
+    return extent.x*extent.y + extent.y*extent.z + extent.z*extent.x;
+}
+
+static bool overlaps(const glm::vec3 &min1, const glm::vec3 &max1, const glm::vec3 &min2, const glm::vec3 &max2) {
+    return max1.x >= min2.x && min1.x <= max2.x && max1.y >= min2.y && min1.y <= max2.y && max1.z >= min2.z && min1.z <= max2.z;
+}
+
+bool BVHNode::isLeaf() const {
+    return count > 0;
+}
+
+BVH::BVH() {
+    mMaxLeafSize = 4;
+    mDepth = 0;
+}
+
+BVH::BVH(const AABB *aabbs, size_t count, size_t maxLeafSize) : BVH() {
+    create(aabbs, count, maxLeafSize);
+}
+
+void BVH::create(const AABB *aabbs, size_t count, size_t maxLeafSize) {
+    HD_ASSERT(maxLeafSize > 0);
+    HD_ASSERT(count <= UINT32_MAX);
+    destroy();
+    if (count == 0) {
+        return;
+    }
+    mMaxLeafSize = maxLeafSize;
+
+    mIndices.resize(count);
+    std::iota(mIndices.begin(), mIndices.end(), 0);
+    mPrimMin.resize(count);
+    mPrimMax.resize(count);
+    mCentroids.resize(count);
+    Parallel::forRange(0, count, PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            mPrimMin[i] = aabbs[i].pos - aabbs[i].size;
+            mPrimMax[i] = aabbs[i].pos + aabbs[i].size;
+            mCentroids[i] = aabbs[i].pos;
+        }
+    });
+
+    // A binary tree with leaves of at least one primitive has at most 2n - 1 nodes
+    mNodes.reserve(count*2 - 1);
+    BVHNode root;
+    root.leftOrFirst = 0;
+    root.count = static_cast<uint32_t>(count);
+    mNodes.push_back(root);
+
+    std::vector<BuildTask> tasks;
+    tasks.push_back({ 0, 0 });
+    while (!tasks.empty()) {
+        BuildTask task = tasks.back();
+        tasks.pop_back();
+        split(task, tasks);
+    }
+    mNodes.shrink_to_fit();
+
+    // Leaves reference primitives through contiguous ranges, store bounds in that order for locality
+    std::vector<glm::vec3> primMin(count), primMax(count);
+    for (size_t i = 0; i < count; i++) {
+        primMin[i] = mPrimMin[mIndices[i]];
+        primMax[i] = mPrimMax[mIndices[i]];
+    }
+    mPrimMin = std::move(primMin);
+    mPrimMax = std::move(primMax);
+    mCentroids = std::vector<glm::vec3>();
+}
+
+void BVH::destroy() {
+    mNodes.clear();
+    mIndices.clear();
+    mPrimMin.clear();
+    mPrimMax.clear();
+    mCentroids.clear();
+    mDepth = 0;
+}
+
+void BVH::refit(const AABB *aabbs, size_t count) {
+    HD_ASSERT(count == mIndices.size());
+    Parallel::forRange(0, count, PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const AABB &aabb = aabbs[mIndices[i]];
+            mPrimMin[i] = aabb.pos - aabb.size;
+            mPrimMax[i] = aabb.pos + aabb.size;
+        }
+    });
+
+    // Children are always stored after their parent, so a reverse pass visits them first
+    for (size_t i = mNodes.size(); i-- > 0;) {
+        BVHNode &node = mNodes[i];
+        if (node.isLeaf()) {
+            node.min = glm::vec3(INFINITY);
+            node.max = glm::vec3(-INFINITY);
+            for (uint32_t j = node.leftOrFirst; j < node.leftOrFirst + node.count; j++) {
+                node.min = glm::min(node.min, mPrimMin[j]);
+                node.max = glm::max(node.max, mPrimMax[j]);
+            }
+        }
+        else {
+            const BVHNode &left = mNodes[node.leftOrFirst];
+            const BVHNode &right = mNodes[node.leftOrFirst + 1];
+            node.min = glm::min(left.min, right.min);
+            node.max = glm::max(left.max, right.max);
+        }
+    }
+}
+
+bool BVH::raycast(const Ray &ray, uint32_t &index, float &dist, float maxDist) const {
+    return raycast(PrecomputedRay(ray, maxDist), index, dist);
+}
+
+bool BVH::raycast(const PrecomputedRay &ray, uint32_t &index, float &dist) const {
+    struct StackEntry {
+        uint32_t node;
+        float dist;
+    };
+
+    dist = INFINITY;
+    float rootDist;
+    if (mNodes.empty() || !ray.intersectAABB(mNodes[0].min, mNodes[0].max, rootDist)) {
+        return false;
+    }
+
+    // maxDist shrinks to the nearest hit so far, which culls farther nodes in the slab tests
+    PrecomputedRay nearestRay = ray;
+    bool hasHit = false;
+    StackEntry stack[MAX_DEPTH + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = { 0, rootDist };
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.dist > nearestRay.maxDist) {
+            continue;
+        }
+
+        const BVHNode &node = mNodes[entry.node];
+        if (node.isLeaf()) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                // Ties go to the lowest index, a ray along a face shared by two boxes enters both at
+                // the same distance and the result must not depend on the traversal order
+                float primDist;
+                if (nearestRay.intersectAABB(mPrimMin[i], mPrimMax[i], primDist) && (!hasHit || primDist < nearestRay.maxDist || mIndices[i] < index)) {
+                    nearestRay.maxDist = primDist;
+                    index = mIndices[i];
+                    hasHit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first
+        const BVHNode &left = mNodes[node.leftOrFirst];
+        const BVHNode &right = mNodes[node.leftOrFirst + 1];
+        float leftDist, rightDist;
+        bool isLeftHit = nearestRay.intersectAABB(left.min, left.max, leftDist);
+        bool isRightHit = nearestRay.intersectAABB(right.min, right.max, rightDist);
+        if (isLeftHit && isRightHit) {
+            if (leftDist < rightDist) {
+                stack[stackSize++] = { node.leftOrFirst + 1, rightDist };
+                stack[stackSize++] = { node.leftOrFirst, leftDist };
+            }
+            else {
+                stack[stackSize++] = { node.leftOrFirst, leftDist };
+                stack[stackSize++] = { node.leftOrFirst + 1, rightDist };
+            }
+        }
+        else if (isLeftHit) {
+            stack[stackSize++] = { node.leftOrFirst, leftDist };
+        }
+        else if (isRightHit) {
+            stack[stackSize++] = { node.leftOrFirst + 1, rightDist };
+        }
+    }
+
+    if (hasHit) {
+        dist = nearestRay.maxDist;
+    }
+    return hasHit;
+}
+
+size_t BVH::queryAABB(const AABB &aabb, std::vector<uint32_t> &indices) const {
+    if (mNodes.empty()) {
+        return 0;
+    }
+
+    glm::vec3 queryMin = aabb.pos - aabb.size;
+    glm::vec3 queryMax = aabb.pos + aabb.size;
+    size_t startSize = indices.size();
+    uint32_t stack[MAX_DEPTH + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BVHNode &node = mNodes[stack[--stackSize]];
+        if (!overlaps(node.min, node.max, queryMin, queryMax)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                if (overlaps(mPrimMin[i], mPrimMax[i], queryMin, queryMax)) {
+                    indices.push_back(mIndices[i]);
+                }
+            }
+        }
+        else {
+            stack[stackSize++] = node.leftOrFirst + 1;
+            stack[stackSize++] = node.leftOrFirst;
+        }
+    }
+    return indices.size() - startSize;
+}
+
+const std::vector<BVHNode> &BVH::getNodes() const {
+    return mNodes;
+}
+
+size_t BVH::getCount() const {
+    return mIndices.size();
+}
+
+size_t BVH::getDepth() const {
+    return mDepth;
+}
+
+void BVH::split(const BuildTask &task, std::vector<BuildTask> &tasks) {
+    uint32_t first = mNodes[task.node].leftOrFirst;
+    uint32_t count = mNodes[task.node].count;
+    glm::vec3 centroidMin, centroidMax;
+    computeBounds(first, count, mNodes[task.node].min, mNodes[task.node].max, centroidMin, centroidMax);
+    mDepth = std::max(mDepth, static_cast<size_t>(task.depth) + 1);
+    if (count <= mMaxLeafSize) {
+        return;
+    }
+
+    // Bin centroids along all three axes at once
+    glm::vec3 extent = centroidMax - centroidMin;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; axis++) {
+        scale[axis] = extent[axis] > 0.0f ? static_cast<float>(BIN_COUNT) / extent[axis] : 0.0f;
+    }
+    auto getBin = [&](uint32_t prim, int axis) {
+        float bin = (mCentroids[prim][axis] - centroidMin[axis])*scale[axis];
+        return std::min(static_cast<size_t>(bin), BIN_COUNT - 1);
+    };
+
+    BVHBin bins[3][BIN_COUNT];
+    std::mutex binsMutex;
+    Parallel::forRange(first, first + count, count >= PARALLEL_MIN_COUNT ? PARALLEL_CHUNK_SIZE : count, [&](size_t begin, size_t end) {
+        BVHBin localBins[3][BIN_COUNT];
+        for (size_t i = begin; i < end; i++) {
+            uint32_t prim = mIndices[i];
+            for (int axis = 0; axis < 3; axis++) {
+                localBins[axis][getBin(prim, axis)].grow(mPrimMin[prim], mPrimMax[prim]);
+            }
+        }
+        std::lock_guard<std::mutex> lock(binsMutex);
+        for (int axis = 0; axis < 3; axis++) {
+            for (size_t i = 0; i < BIN_COUNT; i++) {
+                bins[axis][i].grow(localBins[axis][i]);
+            }
+        }
+    });
+
+    // Sweep the bins from both sides to evaluate the SAH cost of every plane between them
+    float bestCost = INFINITY;
+    int bestAxis = -1;
+    size_t bestBin = 0;
+    for (int axis = 0; axis < 3 && task.depth < MEDIAN_SPLIT_DEPTH; axis++) {
+        if (scale[axis] == 0.0f) {
+            continue;
+        }
+        float leftCosts[BIN_COUNT];
+        BVHBin left, right;
+        for (size_t i = 0; i < BIN_COUNT - 1; i++) {
+            left.grow(bins[axis][i]);
+            leftCosts[i] = left.count > 0 ? getHalfArea(left.min, left.max)*static_cast<float>(left.count) : 0.0f;
+        }
+        for (size_t i = BIN_COUNT - 1; i > 0; i--) {
+            right.grow(bins[axis][i]);
+            size_t leftCount = count - right.count;
+            if (leftCount == 0 || right.count == 0) {
+                continue;
+            }
+            float cost = leftCosts[i - 1] + getHalfArea(right.min, right.max)*static_cast<float>(right.count);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    uint32_t *indices = mIndices.data() + first;
+    uint32_t leftCount;
+    if (bestAxis >= 0) {
+        leftCount = static_cast<uint32_t>(std::partition(indices, indices + count, [&](uint32_t prim) {
+            return getBin(prim, bestAxis) < bestBin;
+        }) - indices);
+    }
+    else {
+        // All centroids coincide or the tree got too deep, split in the middle of the longest axis
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        leftCount = count / 2;
+        std::nth_element(indices, indices + leftCount, indices + count, [&](uint32_t a, uint32_t b) {
+            return mCentroids[a][axis] < mCentroids[b][axis];
+        });
+    }
+
+    uint32_t leftNode = static_cast<uint32_t>(mNodes.size());
+    BVHNode child;
+    child.leftOrFirst = first;
+    child.count = leftCount;
+    mNodes.push_back(child);
+    child.leftOrFirst = first + leftCount;
+    child.count = count - leftCount;
+    mNodes.push_back(child);
+
+    mNodes[task.node].leftOrFirst = leftNode;
+    mNodes[task.node].count = 0;
+    tasks.push_back({ leftNode + 1, task.depth + 1 });
+    tasks.push_back({ leftNode, task.depth + 1 });
+}
+
+void BVH::computeBounds(uint32_t first, uint32_t count, glm::vec3 &aabbMin, glm::vec3 &aabbMax, glm::vec3 &centroidMin, glm::vec3 &centroidMax) const {
+    aabbMin = centroidMin = glm::vec3(INFINITY);
+    aabbMax = centroidMax = glm::vec3(-INFINITY);
+    std::mutex boundsMutex;
+    Parallel::forRange(first, first + count, count >= PARALLEL_MIN_COUNT ? PARALLEL_CHUNK_SIZE : count, [&](size_t begin, size_t end) {
+        glm::vec3 localMin(INFINITY), localMax(-INFINITY);
+        glm::vec3 localCentroidMin(INFINITY), localCentroidMax(-INFINITY);
+        for (size_t i = begin; i < end; i++) {
+            uint32_t prim = mIndices[i];
+            localMin = glm::min(localMin, mPrimMin[prim]);
+            localMax = glm::max(localMax, mPrimMax[prim]);
+            localCentroidMin = glm::min(localCentroidMin, mCentroids[prim]);
+            localCentroidMax = glm::max(localCentroidMax, mCentroids[prim]);
+        }
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        aabbMin = glm::min(aabbMin, localMin);
+        aabbMax = glm::max(aabbMax, localMax);
+        centroidMin = glm::min(centroidMin, localCentroidMin);
+        centroidMax = glm::max(centroidMax, localCentroidMax);
+    });
+}
+
+}
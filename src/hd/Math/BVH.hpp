@@ -0,0 +1,62 @@
+#pragma once
+#include "RayPacket.hpp"
+#include <vector>
+
+namespace hd {
+
+// 32 bytes, two nodes share a cache line. Children of a node are stored next to each other,
+// so only the index of the left one is kept.
+struct alignas(32) BVHNode {
+    bool isLeaf() const;
+
+    glm::vec3 min;
+    uint32_t leftOrFirst; // left child for inner nodes, first primitive for leaves
+    glm::vec3 max;
+    uint32_t count; // primitive count, 0 for inner nodes
+};
+
+// Bounding volume hierarchy over boxes, built top-down with binned SAH. Large nodes are binned in
+// parallel. Queries report indices into the array the tree was built from.
+class BVH {
+public:
+    static const size_t BIN_COUNT = 16;
+    static const size_t MAX_DEPTH = 64;
+
+    BVH();
+    BVH(const AABB *aabbs, size_t count, size_t maxLeafSize = 4);
+
+    void create(const AABB *aabbs, size_t count, size_t maxLeafSize = 4);
+    void destroy();
+    // Updates bounds after boxes moved, the tree topology is kept, so query speed degrades
+    // when boxes move far from where they were at build time
+    void refit(const AABB *aabbs, size_t count);
+
+    // Finds the nearest hit box, rays lying on a box face count as hits as in PrecomputedRay,
+    // boxes hit at the same distance resolve to the lowest index
+    bool raycast(const Ray &ray, uint32_t &index, float &dist, float maxDist = INFINITY) const;
+    bool raycast(const PrecomputedRay &ray, uint32_t &index, float &dist) const;
+    // Appends indices of boxes overlapping the given one, returns the number of appended indices
+    size_t queryAABB(const AABB &aabb, std::vector<uint32_t> &indices) const;
+
+    const std::vector<BVHNode> &getNodes() const;
+    size_t getCount() const;
+    size_t getDepth() const;
+
+private:
+    struct BuildTask {
+        uint32_t node;
+        uint32_t depth;
+    };
+
+    void split(const BuildTask &task, std::vector<BuildTask> &tasks);
+    void computeBounds(uint32_t first, uint32_t count, glm::vec3 &aabbMin, glm::vec3 &aabbMax, glm::vec3 &centroidMin, glm::vec3 &centroidMax) const;
+
+    std::vector<BVHNode> mNodes;
+    std::vector<uint32_t> mIndices;
+    std::vector<glm::vec3> mPrimMin, mPrimMax; // in tree order
+    std::vector<glm::vec3> mCentroids; // build time only
+    size_t mMaxLeafSize;
+    size_t mDepth;
+};
+
+}
@@ -0,0 +1,235 @@
+#include "BatchMath.hpp"
+#include "../Core/Parallel.hpp"
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+// Elements per thread chunk, small enough to balance and large enough to hide the scheduling cost
+static const size_t PARALLEL_CHUNK_SIZE = 4096;
+
+template<typename Func>
+static void runRange(size_t count, bool isParallel, const Func &func) {
+    if (isParallel) {
+        Parallel::forRange(0, count, PARALLEL_CHUNK_SIZE, func);
+    }
+    else {
+        func(0, count);
+    }
+}
+
+#if defined(HD_SIMD_AVX)
+static HD_FORCEINLINE __m256 madd(__m256 a, __m256 b, __m256 c) {
+#   if defined(HD_SIMD_FMA)
+    return _mm256_fmadd_ps(a, b, c);
+#   else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#   endif
+}
+
+// Column times the matching component of each vec4 half: c0*v.x + c1*v.y + c2*v.z + c3*v.w
+static HD_FORCEINLINE __m256 mulColumns(__m256 c0, __m256 c1, __m256 c2, __m256 c3, __m256 v) {
+    __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00));
+    r = madd(c1, _mm256_permute_ps(v, 0x55), r);
+    r = madd(c2, _mm256_permute_ps(v, 0xaa), r);
+    return madd(c3, _mm256_permute_ps(v, 0xff), r);
+}
+#endif
+
+#if defined(HD_SIMD_SSE2)
+static HD_FORCEINLINE __m128 madd(__m128 a, __m128 b, __m128 c) {
+#   if defined(HD_SIMD_FMA)
+    return _mm_fmadd_ps(a, b, c);
+#   else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#   endif
+}
+
+static HD_FORCEINLINE __m128 mulColumns(__m128 c0, __m128 c1, __m128 c2, __m128 c3, __m128 v) {
+    __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, 0x00));
+    r = madd(c1, _mm_shuffle_ps(v, v, 0x55), r);
+    r = madd(c2, _mm_shuffle_ps(v, v, 0xaa), r);
+    return madd(c3, _mm_shuffle_ps(v, v, 0xff), r);
+}
+#endif
+
+static void transformRange(const glm::mat4 &mat, const glm::vec4 *vectors, glm::vec4 *results, size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(HD_SIMD_AVX)
+    __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&mat[0]));
+    __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&mat[1]));
+    __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&mat[2]));
+    __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&mat[3]));
+    for (; i + 2 <= end; i += 2) {
+        __m256 v = _mm256_loadu_ps(&vectors[i].x);
+        _mm256_storeu_ps(&results[i].x, mulColumns(c0, c1, c2, c3, v));
+    }
+#endif
+#if defined(HD_SIMD_SSE2)
+    __m128 c0x4 = _mm_loadu_ps(&mat[0].x);
+    __m128 c1x4 = _mm_loadu_ps(&mat[1].x);
+    __m128 c2x4 = _mm_loadu_ps(&mat[2].x);
+    __m128 c3x4 = _mm_loadu_ps(&mat[3].x);
+    for (; i < end; i++) {
+        _mm_storeu_ps(&results[i].x, mulColumns(c0x4, c1x4, c2x4, c3x4, _mm_loadu_ps(&vectors[i].x)));
+    }
+#else
+    for (; i < end; i++) {
+        results[i] = mat*vectors[i];
+    }
+#endif
+}
+
+static void transformSoARange(const glm::mat4 &mat, const float *const *in, float *const *out, size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(HD_SIMD_AVX)
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(in[0] + i), y = _mm256_loadu_ps(in[1] + i);
+        __m256 z = _mm256_loadu_ps(in[2] + i), w = _mm256_loadu_ps(in[3] + i);
+        for (int row = 0; row < 4; row++) {
+            __m256 r = _mm256_mul_ps(_mm256_set1_ps(mat[0][row]), x);
+            r = madd(_mm256_set1_ps(mat[1][row]), y, r);
+            r = madd(_mm256_set1_ps(mat[2][row]), z, r);
+            r = madd(_mm256_set1_ps(mat[3][row]), w, r);
+            _mm256_storeu_ps(out[row] + i, r);
+        }
+    }
+#elif defined(HD_SIMD_SSE2)
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(in[0] + i), y = _mm_loadu_ps(in[1] + i);
+        __m128 z = _mm_loadu_ps(in[2] + i), w = _mm_loadu_ps(in[3] + i);
+        for (int row = 0; row < 4; row++) {
+            __m128 r = _mm_mul_ps(_mm_set1_ps(mat[0][row]), x);
+            r = madd(_mm_set1_ps(mat[1][row]), y, r);
+            r = madd(_mm_set1_ps(mat[2][row]), z, r);
+            r = madd(_mm_set1_ps(mat[3][row]), w, r);
+            _mm_storeu_ps(out[row] + i, r);
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        glm::vec4 r = mat*glm::vec4(in[0][i], in[1][i], in[2][i], in[3][i]);
+        for (int row = 0; row < 4; row++) {
+            out[row][i] = r[row];
+        }
+    }
+}
+
+// Multiplies a by b[i], a is per element when aStride is 1 and shared when it's 0
+static void multiplyRange(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *results, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        const glm::mat4 &left = a[i*aStride];
+#if defined(HD_SIMD_AVX)
+        // Both inputs are fully loaded before storing, so results may alias either of them
+        __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[0]));
+        __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[1]));
+        __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[2]));
+        __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[3]));
+        __m256 b01 = _mm256_loadu_ps(&b[i][0].x);
+        __m256 b23 = _mm256_loadu_ps(&b[i][2].x);
+        _mm256_storeu_ps(&results[i][0].x, mulColumns(c0, c1, c2, c3, b01));
+        _mm256_storeu_ps(&results[i][2].x, mulColumns(c0, c1, c2, c3, b23));
+#elif defined(HD_SIMD_SSE2)
+        __m128 c0 = _mm_loadu_ps(&left[0].x);
+        __m128 c1 = _mm_loadu_ps(&left[1].x);
+        __m128 c2 = _mm_loadu_ps(&left[2].x);
+        __m128 c3 = _mm_loadu_ps(&left[3].x);
+        __m128 columns[4];
+        for (int j = 0; j < 4; j++) {
+            columns[j] = _mm_loadu_ps(&b[i][j].x);
+        }
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_ps(&results[i][j].x, mulColumns(c0, c1, c2, c3, columns[j]));
+        }
+#else
+        results[i] = left*b[i];
+#endif
+    }
+}
+
+static void quatToMat4Range(const glm::quat *quats, glm::mat4 *results, size_t begin, size_t end) {
+    size_t i = begin;
+#if defined(HD_SIMD_SSE2)
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= end; i += 4) {
+        // Transposing four quaternions gives one register per component
+        __m128 q0 = _mm_loadu_ps(&quats[i].x), q1 = _mm_loadu_ps(&quats[i + 1].x);
+        __m128 q2 = _mm_loadu_ps(&quats[i + 2].x), q3 = _mm_loadu_ps(&quats[i + 3].x);
+        _MM_TRANSPOSE4_PS(q0, q1, q2, q3);
+#   if defined(GLM_FORCE_QUAT_DATA_WXYZ)
+        __m128 w = q0, x = q1, y = q2, z = q3;
+#   else
+        __m128 x = q0, y = q1, z = q2, w = q3;
+#   endif
+        __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+        __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+        __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+        __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+        __m128 columns[3][4] = {
+            { _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy), _mm_setzero_ps() },
+            { _mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx), _mm_setzero_ps() },
+            { _mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)), _mm_setzero_ps() }
+        };
+        // Transposing back turns the component registers into one column per matrix
+        for (int j = 0; j < 3; j++) {
+            _MM_TRANSPOSE4_PS(columns[j][0], columns[j][1], columns[j][2], columns[j][3]);
+            for (int k = 0; k < 4; k++) {
+                _mm_storeu_ps(&results[i + k][j].x, columns[j][k]);
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            results[i + k][3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        const glm::quat &q = quats[i];
+        float xx = q.x*q.x*2.0f, yy = q.y*q.y*2.0f, zz = q.z*q.z*2.0f;
+        float xy = q.x*q.y*2.0f, xz = q.x*q.z*2.0f, yz = q.y*q.z*2.0f;
+        float wx = q.w*q.x*2.0f, wy = q.w*q.y*2.0f, wz = q.w*q.z*2.0f;
+        results[i][0] = glm::vec4(1.0f - (yy + zz), xy + wz, xz - wy, 0.0f);
+        results[i][1] = glm::vec4(xy - wz, 1.0f - (xx + zz), yz + wx, 0.0f);
+        results[i][2] = glm::vec4(xz + wy, yz - wx, 1.0f - (xx + yy), 0.0f);
+        results[i][3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+void BatchMath::transform(const glm::mat4 &mat, const glm::vec4 *vectors, glm::vec4 *results, size_t count, bool isParallel) {
+    runRange(count, isParallel, [&](size_t begin, size_t end) {
+        transformRange(mat, vectors, results, begin, end);
+    });
+}
+
+void BatchMath::transform(const glm::mat4 &mat, const float *x, const float *y, const float *z, const float *w,
+        float *resultX, float *resultY, float *resultZ, float *resultW, size_t count, bool isParallel) {
+    const float *in[] = { x, y, z, w };
+    float *out[] = { resultX, resultY, resultZ, resultW };
+    runRange(count, isParallel, [&](size_t begin, size_t end) {
+        transformSoARange(mat, in, out, begin, end);
+    });
+}
+
+void BatchMath::multiply(const glm::mat4 &a, const glm::mat4 *b, glm::mat4 *results, size_t count, bool isParallel) {
+    // The shared matrix is copied, results may alias it too
+    glm::mat4 left = a;
+    runRange(count, isParallel, [&](size_t begin, size_t end) {
+        multiplyRange(&left, 0, b, results, begin, end);
+    });
+}
+
+void BatchMath::multiply(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *results, size_t count, bool isParallel) {
+    runRange(count, isParallel, [&](size_t begin, size_t end) {
+        multiplyRange(a, 1, b, results, begin, end);
+    });
+}
+
+void BatchMath::quatToMat4(const glm::quat *quats, glm::mat4 *results, size_t count, bool isParallel) {
+    runRange(count, isParallel, [&](size_t begin, size_t end) {
+        quatToMat4Range(quats, results, begin, end);
+    });
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <glm/gtc/quaternion.hpp>
+
+namespace hd {
+
+// Transform kernels over arrays, using AVX (two vec4 or matrix columns per register) or SSE2. Results may
+// point to the inputs. With isParallel large arrays are split across threads with Parallel::forRange.
+class BatchMath : public StaticClass {
+public:
+    // results[i] = mat*vectors[i]
+    static void transform(const glm::mat4 &mat, const glm::vec4 *vectors, glm::vec4 *results, size_t count, bool isParallel = false);
+    // Same for vectors stored as separate component arrays, processes 8 (AVX) or 4 (SSE2) vectors per step
+    static void transform(const glm::mat4 &mat, const float *x, const float *y, const float *z, const float *w,
+        float *resultX, float *resultY, float *resultZ, float *resultW, size_t count, bool isParallel = false);
+
+    // results[i] = a*b[i], e.g. view-projection times world matrices
+    static void multiply(const glm::mat4 &a, const glm::mat4 *b, glm::mat4 *results, size_t count, bool isParallel = false);
+    // results[i] = a[i]*b[i]
+    static void multiply(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *results, size_t count, bool isParallel = false);
+
+    // Rotation matrices of unit quaternions, same as glm::mat4_cast
+    static void quatToMat4(const glm::quat *quats, glm::mat4 *results, size_t count, bool isParallel = false);
+};
+
+}
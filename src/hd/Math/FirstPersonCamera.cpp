@@ -14,6 +14,7 @@ FirstPersonCamera::FirstPersonCamera() : mIsRHMode(false), mPos(0, 0, 0), mRot(0
 }
 
 void FirstPersonCamera::update(float dt) {
+    bool isFrustumDirty = mIsViewDirty || mIsProjDirty;
     if (mIsDirDirty) {
         mIsDirDirty = false;
         glm::mat4 rotMat = glm::eulerAngleX(mRot.x)*glm::eulerAngleY(mRot.y)*glm::eulerAngleZ(mRot.z);
@@ -46,6 +47,10 @@ void FirstPersonCamera::update(float dt) {
             mProjMat = glm::perspectiveLH(mFov, mAspectRatio, mNearClip, mFarClip);
         }
     }
+
+    if (isFrustumDirty) {
+        mFrustum.create(mProjMat*mViewMat);
+    }
 }
 
 void FirstPersonCamera::translate(float x, float y, float z) {
@@ -157,6 +162,10 @@ const glm::mat4 &FirstPersonCamera::getProjMatrix() const {
     return mProjMat;
 }
 
+const Frustum &FirstPersonCamera::getFrustum() const {
+    return mFrustum;
+}
+
 float FirstPersonCamera::getFov() const {
     return mFov;
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "Frustum.hpp"
 #include <glm/glm.hpp>
 
 namespace hd {
@@ -30,6 +31,8 @@ public:
     const glm::vec3 &getDirection() const;
 	const glm::mat4 &getViewMatrix() const;
 	const glm::mat4 &getProjMatrix() const;
+	// Planes of the view and projection matrices as of the last update
+	const Frustum &getFrustum() const;
 	float getFov() const;
 	float getAspectRatio() const;
 	float getNearClip() const;
@@ -40,6 +43,7 @@ private:
 	glm::vec3 mPos, mRot;
 	glm::vec3 mDir;
 	glm::mat4 mViewMat, mProjMat;
+	Frustum mFrustum;
 	float mMaxVertical, mMinVertical;
 	float mFov, mAspectRatio, mNearClip, mFarClip;
 	bool mIsDirDirty, mIsViewDirty, mIsProjDirty;
@@ -0,0 +1,206 @@
+#include "Frustum.hpp"
+#include "AABBBatch.hpp"
+#include "../Core/Log.hpp"
+#include "../Core/Parallel.hpp"
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+// Below this many 64 object words the threading overhead outweighs the work
+static const size_t MIN_WORDS_PER_THREAD = 16;
+
+// Writes visibility bits of spheres [first, first + 8) into the low 8 bits of the result
+static HD_FORCEINLINE uint32_t cullSpheres8(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *radius, size_t first) {
+#if defined(HD_SIMD_AVX)
+    __m256 px = _mm256_loadu_ps(x + first), py = _mm256_loadu_ps(y + first), pz = _mm256_loadu_ps(z + first);
+    __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + first));
+    __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+        __m256 dist = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(planes[i].x)), _mm256_set1_ps(planes[i].w));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(py, _mm256_set1_ps(planes[i].y)));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(pz, _mm256_set1_ps(planes[i].z)));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, negRadius, _CMP_GE_OQ));
+    }
+    return static_cast<uint32_t>(_mm256_movemask_ps(visible));
+#elif defined(HD_SIMD_SSE2)
+    uint32_t bits = 0;
+    for (size_t j = 0; j < 8; j += 4) {
+        __m128 px = _mm_loadu_ps(x + first + j), py = _mm_loadu_ps(y + first + j), pz = _mm_loadu_ps(z + first + j);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + first + j));
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+            __m128 dist = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(planes[i].x)), _mm_set1_ps(planes[i].w));
+            dist = _mm_add_ps(dist, _mm_mul_ps(py, _mm_set1_ps(planes[i].y)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(pz, _mm_set1_ps(planes[i].z)));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, negRadius));
+        }
+        bits |= static_cast<uint32_t>(_mm_movemask_ps(visible)) << j;
+    }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (size_t j = 0; j < 8; j++) {
+        size_t k = first + j;
+        bool visible = true;
+        for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+            visible &= planes[i].x*x[k] + planes[i].w + planes[i].y*y[k] + planes[i].z*z[k] >= -radius[k];
+        }
+        bits |= static_cast<uint32_t>(visible) << j;
+    }
+    return bits;
+#endif
+}
+
+// Writes visibility bits of boxes [first, first + 8) into the low 8 bits of the result
+static HD_FORCEINLINE uint32_t cullAABBs8(const glm::vec4 *planes, const AABBBatch &batch, size_t first) {
+#if defined(HD_SIMD_AVX)
+    __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+        const glm::vec4 &plane = planes[i];
+        __m256 px = _mm256_loadu_ps((plane.x >= 0.0f ? batch.getMaxX() : batch.getMinX()) + first);
+        __m256 py = _mm256_loadu_ps((plane.y >= 0.0f ? batch.getMaxY() : batch.getMinY()) + first);
+        __m256 pz = _mm256_loadu_ps((plane.z >= 0.0f ? batch.getMaxZ() : batch.getMinZ()) + first);
+        __m256 dist = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(py, _mm256_set1_ps(plane.y)));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(pz, _mm256_set1_ps(plane.z)));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    return static_cast<uint32_t>(_mm256_movemask_ps(visible));
+#elif defined(HD_SIMD_SSE2)
+    uint32_t bits = 0;
+    for (size_t j = 0; j < 8; j += 4) {
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+            const glm::vec4 &plane = planes[i];
+            __m128 px = _mm_loadu_ps((plane.x >= 0.0f ? batch.getMaxX() : batch.getMinX()) + first + j);
+            __m128 py = _mm_loadu_ps((plane.y >= 0.0f ? batch.getMaxY() : batch.getMinY()) + first + j);
+            __m128 pz = _mm_loadu_ps((plane.z >= 0.0f ? batch.getMaxZ() : batch.getMinZ()) + first + j);
+            __m128 dist = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            dist = _mm_add_ps(dist, _mm_mul_ps(py, _mm_set1_ps(plane.y)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(pz, _mm_set1_ps(plane.z)));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, _mm_setzero_ps()));
+        }
+        bits |= static_cast<uint32_t>(_mm_movemask_ps(visible)) << j;
+    }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (size_t j = 0; j < 8; j++) {
+        size_t k = first + j;
+        bool visible = true;
+        for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+            const glm::vec4 &plane = planes[i];
+            float px = plane.x >= 0.0f ? batch.getMaxX()[k] : batch.getMinX()[k];
+            float py = plane.y >= 0.0f ? batch.getMaxY()[k] : batch.getMinY()[k];
+            float pz = plane.z >= 0.0f ? batch.getMaxZ()[k] : batch.getMinZ()[k];
+            visible &= plane.x*px + plane.w + plane.y*py + plane.z*pz >= 0.0f;
+        }
+        bits |= static_cast<uint32_t>(visible) << j;
+    }
+    return bits;
+#endif
+}
+
+Frustum::Frustum() {
+    for (size_t i = 0; i < PLANE_COUNT; i++) {
+        mPlanes[i] = glm::vec4(0.0f);
+    }
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjMat) {
+    create(viewProjMat);
+}
+
+void Frustum::create(const glm::mat4 &viewProjMat) {
+    // Gribb/Hartmann, clip space planes are combinations of the matrix rows
+    glm::vec4 row0(viewProjMat[0][0], viewProjMat[1][0], viewProjMat[2][0], viewProjMat[3][0]);
+    glm::vec4 row1(viewProjMat[0][1], viewProjMat[1][1], viewProjMat[2][1], viewProjMat[3][1]);
+    glm::vec4 row2(viewProjMat[0][2], viewProjMat[1][2], viewProjMat[2][2], viewProjMat[3][2]);
+    glm::vec4 row3(viewProjMat[0][3], viewProjMat[1][3], viewProjMat[2][3], viewProjMat[3][3]);
+
+    mPlanes[static_cast<size_t>(FrustumPlane::Left)] = row3 + row0;
+    mPlanes[static_cast<size_t>(FrustumPlane::Right)] = row3 - row0;
+    mPlanes[static_cast<size_t>(FrustumPlane::Bottom)] = row3 + row1;
+    mPlanes[static_cast<size_t>(FrustumPlane::Top)] = row3 - row1;
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+    mPlanes[static_cast<size_t>(FrustumPlane::Near)] = row2;
+#else
+    mPlanes[static_cast<size_t>(FrustumPlane::Near)] = row3 + row2;
+#endif
+    mPlanes[static_cast<size_t>(FrustumPlane::Far)] = row3 - row2;
+
+    for (size_t i = 0; i < PLANE_COUNT; i++) {
+        float length = glm::length(glm::vec3(mPlanes[i]));
+        HD_ASSERT(length > 0.0f);
+        mPlanes[i] /= length;
+    }
+}
+
+bool Frustum::intersectSphere(const glm::vec3 &center, float radius) const {
+    for (size_t i = 0; i < PLANE_COUNT; i++) {
+        if (glm::dot(glm::vec3(mPlanes[i]), center) + mPlanes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectAABB(const AABB &aabb) const {
+    for (size_t i = 0; i < PLANE_COUNT; i++) {
+        glm::vec3 normal(mPlanes[i]);
+        if (glm::dot(normal, aabb.pos) + glm::dot(glm::abs(normal), aabb.size) + mPlanes[i].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Frustum::cullSpheres(const float *x, const float *y, const float *z, const float *radius, size_t count, std::vector<uint64_t> &mask) const {
+    mask.resize((count + 63) / 64);
+    Parallel::forRange(0, mask.size(), MIN_WORDS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t word = begin; word < end; word++) {
+            uint64_t bits = 0;
+            for (size_t first = word*64; first < word*64 + 64 && first < count; first += 8) {
+                uint64_t groupBits = 0;
+                if (first + 8 <= count) {
+                    groupBits = cullSpheres8(mPlanes, x, y, z, radius, first);
+                }
+                else {
+                    for (size_t i = first; i < count; i++) {
+                        groupBits |= static_cast<uint64_t>(intersectSphere(glm::vec3(x[i], y[i], z[i]), radius[i])) << (i - first);
+                    }
+                }
+                bits |= groupBits << (first - word*64);
+            }
+            mask[word] = bits;
+        }
+    });
+}
+
+void Frustum::cullAABBs(const AABBBatch &batch, std::vector<uint64_t> &mask) const {
+    size_t count = batch.getCount();
+    mask.resize((count + 63) / 64);
+    Parallel::forRange(0, mask.size(), MIN_WORDS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t word = begin; word < end; word++) {
+            // The batch is padded to 8 boxes, only bits past the count need clearing
+            uint64_t bits = 0;
+            for (size_t first = word*64; first < word*64 + 64 && first < count; first += 8) {
+                bits |= static_cast<uint64_t>(cullAABBs8(mPlanes, batch, first)) << (first - word*64);
+            }
+            size_t remaining = count - word*64;
+            if (remaining < 64) {
+                bits &= (static_cast<uint64_t>(1) << remaining) - 1;
+            }
+            mask[word] = bits;
+        }
+    });
+}
+
+const glm::vec4 &Frustum::getPlane(FrustumPlane plane) const {
+    return mPlanes[static_cast<size_t>(plane)];
+}
+
+}
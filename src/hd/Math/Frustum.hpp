@@ -0,0 +1,46 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <vector>
+
+namespace hd {
+
+class AABBBatch;
+
+enum class FrustumPlane {
+    Left,
+    Right,
+    Bottom,
+    Top,
+    Near,
+    Far
+};
+
+// View frustum as six normalized planes pointing inwards, a point p is inside a plane if dot(n, p) + d >= 0.
+// Box tests use the corner furthest along the plane normal, so they are conservative: a box near
+// a frustum corner may be reported visible although it's outside.
+class Frustum {
+public:
+    static const size_t PLANE_COUNT = 6;
+
+    Frustum();
+    explicit Frustum(const glm::mat4 &viewProjMat);
+
+    // Extracts the planes from a view-projection matrix, the depth range follows GLM_FORCE_DEPTH_ZERO_TO_ONE
+    void create(const glm::mat4 &viewProjMat);
+
+    bool intersectSphere(const glm::vec3 &center, float radius) const;
+    bool intersectAABB(const AABB &aabb) const;
+
+    // Sets bit i of mask[i / 64] if sphere i is at least partially inside, the mask is resized to hold count bits.
+    // Coordinates and radii are separate arrays, large inputs are split across threads with Parallel::forRange.
+    void cullSpheres(const float *x, const float *y, const float *z, const float *radius, size_t count, std::vector<uint64_t> &mask) const;
+    // Same as cullSpheres for the boxes of the batch
+    void cullAABBs(const AABBBatch &batch, std::vector<uint64_t> &mask) const;
+
+    const glm::vec4 &getPlane(FrustumPlane plane) const;
+
+private:
+    glm::vec4 mPlanes[PLANE_COUNT];
+};
+
+}
@@ -1,22 +1,243 @@
 #include "MathUtils.hpp"
+#include "Random.hpp"
+#include <atomic>
+#include <chrono>
 #include <cmath>
-#include <ctime>
+#include <random>
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+#   include <immintrin.h>
+#endif
 
 namespace hd {
 
-class Random : public Singleton<Random> {
-public:
-    Random() {
-        srand(static_cast<uint32_t>(std::clock()));
+// pi/2 split in three parts (Cody-Waite), the first two have enough trailing zeros to multiply exactly
+static const float TWO_OVER_PI = 0.636619772367581f;
+static const float PI_OVER_2_PART1 = 1.5703125f;
+static const float PI_OVER_2_PART2 = 4.837512969970703125e-4f;
+static const float PI_OVER_2_PART3 = 7.54978995489188216e-8f;
+
+// Low and Medium are fitted on [-pi/4, pi/4], High are the cephes sinf/cosf coefficients
+static const float SIN_LOW_1 = -1.6225901e-1f;
+static const float COS_LOW_1 = -4.9977630e-1f;
+static const float COS_LOW_2 = 4.0488915e-2f;
+static const float SIN_MEDIUM_1 = -1.6662834e-1f;
+static const float SIN_MEDIUM_2 = 8.1529895e-3f;
+static const float COS_MEDIUM_1 = -4.9999895e-1f;
+static const float COS_MEDIUM_2 = 4.1656294e-2f;
+static const float COS_MEDIUM_3 = -1.3597820e-3f;
+static const float SIN_HIGH_1 = -1.6666654611e-1f;
+static const float SIN_HIGH_2 = 8.3321608736e-3f;
+static const float SIN_HIGH_3 = -1.9515295891e-4f;
+static const float COS_HIGH_1 = -0.5f;
+static const float COS_HIGH_2 = 4.166664568298827e-2f;
+static const float COS_HIGH_3 = -1.388731625493765e-3f;
+static const float COS_HIGH_4 = 2.443315711809948e-5f;
+
+// Sine and cosine of r in [-pi/4, pi/4], r2 = r*r
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCosPoly(float r, float r2, float &sin, float &cos) {
+    if constexpr (P == SinCosPrecision::Low) {
+        sin = r + r*r2*SIN_LOW_1;
+        cos = 1.0f + r2*(COS_LOW_1 + r2*COS_LOW_2);
+    }
+    else if constexpr (P == SinCosPrecision::Medium) {
+        sin = r + r*r2*(SIN_MEDIUM_1 + r2*SIN_MEDIUM_2);
+        cos = 1.0f + r2*(COS_MEDIUM_1 + r2*(COS_MEDIUM_2 + r2*COS_MEDIUM_3));
+    }
+    else {
+        sin = r + r*r2*(SIN_HIGH_1 + r2*(SIN_HIGH_2 + r2*SIN_HIGH_3));
+        cos = 1.0f + r2*(COS_HIGH_1 + r2*(COS_HIGH_2 + r2*(COS_HIGH_3 + r2*COS_HIGH_4)));
+    }
+}
+
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCos1(float angle, float &sin, float &cos) {
+    // Same rounding as the SIMD versions, so a value doesn't depend on its position in a batch
+#if defined(HD_SIMD_SSE2)
+    int quadrant = _mm_cvtss_si32(_mm_set_ss(angle*TWO_OVER_PI));
+#else
+    int quadrant = static_cast<int>(std::floor(angle*TWO_OVER_PI + 0.5f));
+#endif
+    float j = static_cast<float>(quadrant);
+    float r = ((angle - j*PI_OVER_2_PART1) - j*PI_OVER_2_PART2) - j*PI_OVER_2_PART3;
+    float s, c;
+    sinCosPoly<P>(r, r*r, s, c);
+    if (quadrant & 1) {
+        std::swap(s, c);
+    }
+    sin = (quadrant & 2) ? -s : s;
+    cos = ((quadrant + 1) & 2) ? -c : c;
+}
+
+#if defined(HD_SIMD_AVX2)
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCosPoly8(__m256 r, __m256 r2, __m256 &sin, __m256 &cos) {
+    __m256 r3 = _mm256_mul_ps(r, r2);
+    if constexpr (P == SinCosPrecision::Low) {
+        sin = _mm256_add_ps(r, _mm256_mul_ps(r3, _mm256_set1_ps(SIN_LOW_1)));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(COS_LOW_2)), _mm256_set1_ps(COS_LOW_1));
+    }
+    else if constexpr (P == SinCosPrecision::Medium) {
+        sin = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(SIN_MEDIUM_2)), _mm256_set1_ps(SIN_MEDIUM_1));
+        sin = _mm256_add_ps(r, _mm256_mul_ps(r3, sin));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(COS_MEDIUM_3)), _mm256_set1_ps(COS_MEDIUM_2));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, cos), _mm256_set1_ps(COS_MEDIUM_1));
+    }
+    else {
+        sin = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(SIN_HIGH_3)), _mm256_set1_ps(SIN_HIGH_2));
+        sin = _mm256_add_ps(_mm256_mul_ps(r2, sin), _mm256_set1_ps(SIN_HIGH_1));
+        sin = _mm256_add_ps(r, _mm256_mul_ps(r3, sin));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(COS_HIGH_4)), _mm256_set1_ps(COS_HIGH_3));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, cos), _mm256_set1_ps(COS_HIGH_2));
+        cos = _mm256_add_ps(_mm256_mul_ps(r2, cos), _mm256_set1_ps(COS_HIGH_1));
+    }
+    cos = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r2, cos));
+}
+
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCos8(__m256 angle, __m256 &sin, __m256 &cos) {
+    __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256 j = _mm256_cvtepi32_ps(quadrant);
+    __m256 r = _mm256_sub_ps(angle, _mm256_mul_ps(j, _mm256_set1_ps(PI_OVER_2_PART1)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(PI_OVER_2_PART2)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(PI_OVER_2_PART3)));
+    __m256 s, c;
+    sinCosPoly8<P>(r, _mm256_mul_ps(r, r), s, c);
+
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+    sin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+    cos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+}
+#endif
+
+#if defined(HD_SIMD_SSE2)
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCosPoly4(__m128 r, __m128 r2, __m128 &sin, __m128 &cos) {
+    __m128 r3 = _mm_mul_ps(r, r2);
+    if constexpr (P == SinCosPrecision::Low) {
+        sin = _mm_add_ps(r, _mm_mul_ps(r3, _mm_set1_ps(SIN_LOW_1)));
+        cos = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(COS_LOW_2)), _mm_set1_ps(COS_LOW_1));
+    }
+    else if constexpr (P == SinCosPrecision::Medium) {
+        sin = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(SIN_MEDIUM_2)), _mm_set1_ps(SIN_MEDIUM_1));
+        sin = _mm_add_ps(r, _mm_mul_ps(r3, sin));
+        cos = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(COS_MEDIUM_3)), _mm_set1_ps(COS_MEDIUM_2));
+        cos = _mm_add_ps(_mm_mul_ps(r2, cos), _mm_set1_ps(COS_MEDIUM_1));
+    }
+    else {
+        sin = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(SIN_HIGH_3)), _mm_set1_ps(SIN_HIGH_2));
+        sin = _mm_add_ps(_mm_mul_ps(r2, sin), _mm_set1_ps(SIN_HIGH_1));
+        sin = _mm_add_ps(r, _mm_mul_ps(r3, sin));
+        cos = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(COS_HIGH_4)), _mm_set1_ps(COS_HIGH_3));
+        cos = _mm_add_ps(_mm_mul_ps(r2, cos), _mm_set1_ps(COS_HIGH_2));
+        cos = _mm_add_ps(_mm_mul_ps(r2, cos), _mm_set1_ps(COS_HIGH_1));
+    }
+    cos = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, cos));
+}
+
+template<SinCosPrecision P>
+static HD_FORCEINLINE void sinCos4(__m128 angle, __m128 &sin, __m128 &cos) {
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 j = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(angle, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_PART1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_PART2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_PART3)));
+    __m128 s, c;
+    sinCosPoly4<P>(r, _mm_mul_ps(r, r), s, c);
+
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+    sin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+    cos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+}
+#endif
+
+template<SinCosPrecision P>
+static void sinCosBatch(const float *angles, float *sines, float *cosines, size_t count) {
+    size_t i = 0;
+#if defined(HD_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256 s, c;
+        sinCos8<P>(_mm256_loadu_ps(angles + i), s, c);
+        _mm256_storeu_ps(sines + i, s);
+        _mm256_storeu_ps(cosines + i, c);
+    }
+#elif defined(HD_SIMD_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 s, c;
+        sinCos4<P>(_mm_loadu_ps(angles + i), s, c);
+        _mm_storeu_ps(sines + i, s);
+        _mm_storeu_ps(cosines + i, c);
     }
+#endif
+    for (; i < count; i++) {
+        sinCos1<P>(angles[i], sines[i], cosines[i]);
+    }
+}
 
-    int next() {
-        return rand();
+template<SinCosPrecision P>
+static void rotate2DBatch(const glm::vec2 *vectors, const float *angles, glm::vec2 *results, size_t count) {
+    size_t i = 0;
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+    const float *src = reinterpret_cast<const float *>(vectors);
+    float *dst = reinterpret_cast<float *>(results);
+#endif
+#if defined(HD_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        // Reorder halves so the in-lane shuffles give x and y in element order
+        __m256 a = _mm256_loadu_ps(src + i*2);
+        __m256 b = _mm256_loadu_ps(src + i*2 + 8);
+        __m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+        __m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+        __m256 x = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 y = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 s, c;
+        sinCos8<P>(_mm256_loadu_ps(angles + i), s, c);
+        __m256 rx = _mm256_sub_ps(_mm256_mul_ps(x, c), _mm256_mul_ps(y, s));
+        __m256 ry = _mm256_add_ps(_mm256_mul_ps(y, c), _mm256_mul_ps(x, s));
+        __m256 xy0 = _mm256_unpacklo_ps(rx, ry);
+        __m256 xy1 = _mm256_unpackhi_ps(rx, ry);
+        _mm256_storeu_ps(dst + i*2, _mm256_permute2f128_ps(xy0, xy1, 0x20));
+        _mm256_storeu_ps(dst + i*2 + 8, _mm256_permute2f128_ps(xy0, xy1, 0x31));
+    }
+#elif defined(HD_SIMD_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(src + i*2);
+        __m128 b = _mm_loadu_ps(src + i*2 + 4);
+        __m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 s, c;
+        sinCos4<P>(_mm_loadu_ps(angles + i), s, c);
+        __m128 rx = _mm_sub_ps(_mm_mul_ps(x, c), _mm_mul_ps(y, s));
+        __m128 ry = _mm_add_ps(_mm_mul_ps(y, c), _mm_mul_ps(x, s));
+        _mm_storeu_ps(dst + i*2, _mm_unpacklo_ps(rx, ry));
+        _mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(rx, ry));
     }
-};
+#endif
+    for (; i < count; i++) {
+        float s, c;
+        sinCos1<P>(angles[i], s, c);
+        glm::vec2 v = vectors[i];
+        results[i] = glm::vec2(v.x*c - v.y*s, v.y*c + v.x*s);
+    }
+}
 
 int MathUtils::randomInt32(int min, int max) {
-    return Random::get().next() % max + min;
+    return Random::getThreadLocal().nextInt32(min, max);
+}
+
+uint64_t MathUtils::randomSeed() {
+    // random_device may be deterministic on some platforms, the clock and counter still keep seeds apart
+    static std::atomic<uint64_t> counter(0);
+    uint64_t seed = std::random_device()();
+    seed = (seed << 32) ^ static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    return seed ^ (counter++*0x9e3779b97f4a7c15ULL);
 }
 
 glm::mat4 MathUtils::ortho2D(float left, float right, float bottom, float top) {
@@ -29,9 +250,11 @@ glm::mat4 MathUtils::ortho2D(float left, float right, float bottom, float top) {
 }
 
 glm::vec2 MathUtils::rotate2D(float vx, float vy, float angle) {
+    float sin = sinf(angle);
+    float cos = cosf(angle);
     return glm::vec2(
-        vx*cosf(angle) - vy*sinf(angle),
-        vy*cosf(angle) + vx*sinf(angle)
+        vx*cos - vy*sin,
+        vy*cos + vx*sin
     );
 }
 
@@ -39,6 +262,57 @@ glm::vec2 MathUtils::rotate2D(const glm::vec2 &v, float angle) {
     return rotate2D(v.x, v.y, angle);
 }
 
+void MathUtils::sinCos(float angle, float &sin, float &cos, SinCosPrecision precision) {
+    switch (precision) {
+        case SinCosPrecision::Low: {
+            sinCos1<SinCosPrecision::Low>(angle, sin, cos);
+            break;
+        }
+        case SinCosPrecision::Medium: {
+            sinCos1<SinCosPrecision::Medium>(angle, sin, cos);
+            break;
+        }
+        case SinCosPrecision::High: {
+            sinCos1<SinCosPrecision::High>(angle, sin, cos);
+            break;
+        }
+    }
+}
+
+void MathUtils::sinCos(const float *angles, float *sines, float *cosines, size_t count, SinCosPrecision precision) {
+    switch (precision) {
+        case SinCosPrecision::Low: {
+            sinCosBatch<SinCosPrecision::Low>(angles, sines, cosines, count);
+            break;
+        }
+        case SinCosPrecision::Medium: {
+            sinCosBatch<SinCosPrecision::Medium>(angles, sines, cosines, count);
+            break;
+        }
+        case SinCosPrecision::High: {
+            sinCosBatch<SinCosPrecision::High>(angles, sines, cosines, count);
+            break;
+        }
+    }
+}
+
+void MathUtils::rotate2D(const glm::vec2 *vectors, const float *angles, glm::vec2 *results, size_t count, SinCosPrecision precision) {
+    switch (precision) {
+        case SinCosPrecision::Low: {
+            rotate2DBatch<SinCosPrecision::Low>(vectors, angles, results, count);
+            break;
+        }
+        case SinCosPrecision::Medium: {
+            rotate2DBatch<SinCosPrecision::Medium>(vectors, angles, results, count);
+            break;
+        }
+        case SinCosPrecision::High: {
+            rotate2DBatch<SinCosPrecision::High>(vectors, angles, results, count);
+            break;
+        }
+    }
+}
+
 AABB::AABB() : pos(0, 0, 0), size(0, 0, 0) {
 }
 
@@ -4,8 +4,19 @@
 #include <limits>
 #include <cmath>
 
+#ifdef HD_COMPILER_VC
+#   include <intrin.h>
+#endif
+
 namespace hd {
 
+// Polynomial degree of the sinCos approximations, errors are absolute for angles within a few thousand radians
+enum class SinCosPrecision {
+    Low,    // about 3e-4
+    Medium, // about 1e-6
+    High    // about 1e-7, close to sinf/cosf
+};
+
 class MathUtils : public StaticClass {
 public:
     template<typename T>
@@ -20,12 +31,42 @@ public:
     template<typename T, glm::length_t S, glm::qualifier P>
     static bool isNearlyEqual(const glm::vec<S, T, P> &a, const glm::vec<S, T, P> &b, int epsilonFactor);
 
+    // Index of the lowest set bit, value must not be zero
+    static int countTrailingZeros(uint64_t value);
+
+    // Uniform in [min, max), drawn from the thread local Random generator
     static int randomInt32(int min, int max);
+    // Different on every call, for seeding generators
+    static uint64_t randomSeed();
     static glm::mat4 ortho2D(float left, float right, float bottom, float top);
     static glm::vec2 rotate2D(float vx, float vy, float angle);
     static glm::vec2 rotate2D(const glm::vec2 &v, float angle);
+
+    // Fast sine and cosine computed together from one range reduction
+    static void sinCos(float angle, float &sin, float &cos, SinCosPrecision precision = SinCosPrecision::High);
+    // Batched versions run 8 (AVX2) or 4 (SSE2) values at a time, results are the same as the scalar version
+    static void sinCos(const float *angles, float *sines, float *cosines, size_t count, SinCosPrecision precision = SinCosPrecision::High);
+    // Rotates each vector by its own angle, results may point to the vectors
+    static void rotate2D(const glm::vec2 *vectors, const float *angles, glm::vec2 *results, size_t count, SinCosPrecision precision = SinCosPrecision::High);
 };
 
+HD_FORCEINLINE int MathUtils::countTrailingZeros(uint64_t value) {
+#if defined(HD_COMPILER_VC) && defined(HD_ARCH_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#elif defined(HD_COMPILER_VC)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+        return static_cast<int>(index);
+    }
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return static_cast<int>(index) + 32;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
 template<typename T>
 bool MathUtils::isNearlyEqual(T a, T b) {
     return std::nextafter(a, std::numeric_limits<T>::lowest()) <= b && std::nextafter(a, std::numeric_limits<T>::max()) >= b;
@@ -0,0 +1,247 @@
+#include "Philox.hpp"
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+static const uint32_t PHILOX_M0 = 0xd2511f53;
+static const uint32_t PHILOX_M1 = 0xcd9e8d57;
+static const uint32_t PHILOX_W0 = 0x9e3779b9;
+static const uint32_t PHILOX_W1 = 0xbb67ae85;
+static const int PHILOX_ROUNDS = 10;
+
+// Blocks generated per call when filling, values go through a small buffer on the stack
+static const size_t FILL_CHUNK_BLOCKS = 64;
+
+#if defined(HD_SIMD_AVX2)
+// Full 32x32 bit products of all lanes, mul_epu32 only takes the even ones so odd lanes are shifted down
+static HD_FORCEINLINE void mulHiLo8(__m256i a, __m256i m, __m256i &hi, __m256i &lo) {
+    const __m256i lowMask = _mm256_set1_epi64x(0xffffffff);
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_or_si256(_mm256_and_si256(even, lowMask), _mm256_slli_epi64(odd, 32));
+    hi = _mm256_or_si256(_mm256_srli_epi64(even, 32), _mm256_andnot_si256(lowMask, odd));
+}
+
+static void generate8(const uint32_t key[2], uint64_t stream, uint64_t firstBlock, uint32_t *values) {
+    uint32_t low[8], high[8];
+    for (int i = 0; i < 8; i++) {
+        low[i] = static_cast<uint32_t>(firstBlock + i);
+        high[i] = static_cast<uint32_t>((firstBlock + i) >> 32);
+    }
+    __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(low));
+    __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(high));
+    __m256i x2 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+    __m256i x3 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+    const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+    const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        __m256i hi0, lo0, hi1, lo1;
+        mulHiLo8(x0, m0, hi0, lo0);
+        mulHiLo8(x2, m1, hi1, lo1);
+        x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32(static_cast<int>(k0)));
+        x1 = lo1;
+        x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32(static_cast<int>(k1)));
+        x3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    // Transpose from one register per word to one block per 128 bits, halves hold blocks 0-3 and 4-7
+    __m256i t0 = _mm256_unpacklo_epi32(x0, x1);
+    __m256i t1 = _mm256_unpacklo_epi32(x2, x3);
+    __m256i t2 = _mm256_unpackhi_epi32(x0, x1);
+    __m256i t3 = _mm256_unpackhi_epi32(x2, x3);
+    __m256i blocks[4] = {
+        _mm256_unpacklo_epi64(t0, t1),
+        _mm256_unpackhi_epi64(t0, t1),
+        _mm256_unpacklo_epi64(t2, t3),
+        _mm256_unpackhi_epi64(t2, t3)
+    };
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values + i*4), _mm256_castsi256_si128(blocks[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 16 + i*4), _mm256_extracti128_si256(blocks[i], 1));
+    }
+}
+#elif defined(HD_SIMD_SSE2)
+static HD_FORCEINLINE void mulHiLo4(__m128i a, __m128i m, __m128i &hi, __m128i &lo) {
+    const __m128i lowMask = _mm_set1_epi64x(0xffffffff);
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+    lo = _mm_or_si128(_mm_and_si128(even, lowMask), _mm_slli_epi64(odd, 32));
+    hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(lowMask, odd));
+}
+
+static void generate4(const uint32_t key[2], uint64_t stream, uint64_t firstBlock, uint32_t *values) {
+    __m128i x0 = _mm_setr_epi32(
+        static_cast<int>(static_cast<uint32_t>(firstBlock)), static_cast<int>(static_cast<uint32_t>(firstBlock + 1)),
+        static_cast<int>(static_cast<uint32_t>(firstBlock + 2)), static_cast<int>(static_cast<uint32_t>(firstBlock + 3)));
+    __m128i x1 = _mm_setr_epi32(
+        static_cast<int>(static_cast<uint32_t>(firstBlock >> 32)), static_cast<int>(static_cast<uint32_t>((firstBlock + 1) >> 32)),
+        static_cast<int>(static_cast<uint32_t>((firstBlock + 2) >> 32)), static_cast<int>(static_cast<uint32_t>((firstBlock + 3) >> 32)));
+    __m128i x2 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+    __m128i x3 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+    const __m128i m0 = _mm_set1_epi32(static_cast<int>(PHILOX_M0));
+    const __m128i m1 = _mm_set1_epi32(static_cast<int>(PHILOX_M1));
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        __m128i hi0, lo0, hi1, lo1;
+        mulHiLo4(x0, m0, hi0, lo0);
+        mulHiLo4(x2, m1, hi1, lo1);
+        x0 = _mm_xor_si128(_mm_xor_si128(hi1, x1), _mm_set1_epi32(static_cast<int>(k0)));
+        x1 = lo1;
+        x2 = _mm_xor_si128(_mm_xor_si128(hi0, x3), _mm_set1_epi32(static_cast<int>(k1)));
+        x3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    __m128i t0 = _mm_unpacklo_epi32(x0, x1);
+    __m128i t1 = _mm_unpacklo_epi32(x2, x3);
+    __m128i t2 = _mm_unpackhi_epi32(x0, x1);
+    __m128i t3 = _mm_unpackhi_epi32(x2, x3);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 4), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 8), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 12), _mm_unpackhi_epi64(t2, t3));
+}
+#endif
+
+static void makeKey(uint64_t seed, uint32_t key[2]) {
+    key[0] = static_cast<uint32_t>(seed);
+    key[1] = static_cast<uint32_t>(seed >> 32);
+}
+
+static void makeCounter(uint64_t stream, uint64_t block, uint32_t counter[4]) {
+    counter[0] = static_cast<uint32_t>(block);
+    counter[1] = static_cast<uint32_t>(block >> 32);
+    counter[2] = static_cast<uint32_t>(stream);
+    counter[3] = static_cast<uint32_t>(stream >> 32);
+}
+
+Philox4x32::Philox4x32() {
+    seed(0, 0);
+}
+
+Philox4x32::Philox4x32(uint64_t seed, uint64_t stream) {
+    this->seed(seed, stream);
+}
+
+void Philox4x32::seed(uint64_t seed, uint64_t stream) {
+    mSeed = seed;
+    mStream = stream;
+    mBlock = 0;
+    mBufferIndex = BLOCK_SIZE;
+}
+
+void Philox4x32::discard(uint64_t count) {
+    setPosition(getPosition() + count);
+}
+
+void Philox4x32::setPosition(uint64_t position) {
+    mBlock = position / BLOCK_SIZE;
+    mBufferIndex = BLOCK_SIZE;
+    size_t offset = static_cast<size_t>(position % BLOCK_SIZE);
+    if (offset > 0) {
+        refill();
+        mBufferIndex = offset;
+    }
+}
+
+uint64_t Philox4x32::getPosition() const {
+    return mBlock*BLOCK_SIZE - (BLOCK_SIZE - mBufferIndex);
+}
+
+void Philox4x32::fill(uint64_t *values, size_t count) {
+    // Finish the current block first, so the result matches repeated nextUint64 calls
+    while (count > 0 && mBufferIndex + 2 <= BLOCK_SIZE) {
+        *values++ = nextUint64();
+        count--;
+    }
+
+    // After an odd number of nextUint32 calls one word of the block is left. It becomes the low half of the
+    // first value, and from then on every generated chunk leaves its last word for the next one.
+    bool hasCarry = mBufferIndex == BLOCK_SIZE - 1;
+    uint32_t carry = hasCarry ? mBuffer[mBufferIndex] : 0;
+    size_t carryCount = hasCarry ? 1 : 0;
+    uint32_t buffer[FILL_CHUNK_BLOCKS*BLOCK_SIZE];
+    while (count*2 >= BLOCK_SIZE + carryCount) {
+        size_t blockCount = std::min((count*2 - carryCount) / BLOCK_SIZE, FILL_CHUNK_BLOCKS);
+        generate(mSeed, mStream, mBlock, buffer, blockCount);
+        mBlock += blockCount;
+        size_t wordCount = blockCount*BLOCK_SIZE;
+        size_t i = 0;
+        if (hasCarry) {
+            *values++ = carry | (static_cast<uint64_t>(buffer[0]) << 32);
+            carry = buffer[wordCount - 1];
+            i = 1;
+        }
+        for (; i + 2 <= wordCount; i += 2) {
+            *values++ = buffer[i] | (static_cast<uint64_t>(buffer[i + 1]) << 32);
+        }
+        count -= blockCount*(BLOCK_SIZE / 2);
+    }
+    if (hasCarry) {
+        // Only the last word of the buffered block is still unread
+        mBuffer[BLOCK_SIZE - 1] = carry;
+        mBufferIndex = BLOCK_SIZE - 1;
+    }
+
+    while (count > 0) {
+        *values++ = nextUint64();
+        count--;
+    }
+}
+
+void Philox4x32::generate(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint32_t *values, size_t blockCount) {
+    uint32_t key[2];
+    makeKey(seed, key);
+    size_t i = 0;
+#if defined(HD_SIMD_AVX2)
+    for (; i + 8 <= blockCount; i += 8) {
+        generate8(key, stream, firstBlock + i, values + i*BLOCK_SIZE);
+    }
+#elif defined(HD_SIMD_SSE2)
+    for (; i + 4 <= blockCount; i += 4) {
+        generate4(key, stream, firstBlock + i, values + i*BLOCK_SIZE);
+    }
+#endif
+    for (; i < blockCount; i++) {
+        uint32_t counter[4];
+        makeCounter(stream, firstBlock + i, counter);
+        generateBlock(counter, key, values + i*BLOCK_SIZE);
+    }
+}
+
+void Philox4x32::generateBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]) {
+    uint32_t x0 = counter[0], x1 = counter[1], x2 = counter[2], x3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t product0 = static_cast<uint64_t>(PHILOX_M0)*x0;
+        uint64_t product1 = static_cast<uint64_t>(PHILOX_M1)*x2;
+        x0 = static_cast<uint32_t>(product1 >> 32) ^ x1 ^ k0;
+        x1 = static_cast<uint32_t>(product1);
+        x2 = static_cast<uint32_t>(product0 >> 32) ^ x3 ^ k1;
+        x3 = static_cast<uint32_t>(product0);
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    result[0] = x0;
+    result[1] = x1;
+    result[2] = x2;
+    result[3] = x3;
+}
+
+void Philox4x32::refill() {
+    uint32_t counter[4], key[2];
+    makeCounter(mStream, mBlock, counter);
+    makeKey(mSeed, key);
+    generateBlock(counter, key, mBuffer);
+    mBlock++;
+    mBufferIndex = 0;
+}
+
+}
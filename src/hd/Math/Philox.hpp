@@ -0,0 +1,67 @@
+#pragma once
+#include "Random.hpp"
+
+namespace hd {
+
+// Counter-based Philox4x32-10 generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// Each 128 bit block is a pure function of (seed, stream, block index), so any position of any stream
+// can be computed directly. Parallel jobs that use their job or item index as stream get the same numbers
+// no matter which thread runs them, without sharing any state.
+class Philox4x32 {
+public:
+    using result_type = uint32_t;
+
+    static const size_t BLOCK_SIZE = 4;
+
+    Philox4x32();
+    explicit Philox4x32(uint64_t seed, uint64_t stream = 0);
+
+    void seed(uint64_t seed, uint64_t stream = 0);
+    uint32_t nextUint32();
+    // Low half comes first, so fill() and repeated calls give the same values
+    uint64_t nextUint64();
+    // Skips count 32 bit values in constant time
+    void discard(uint64_t count);
+    void setPosition(uint64_t position);
+    // Number of 32 bit values drawn so far
+    uint64_t getPosition() const;
+    void fill(uint64_t *values, size_t count);
+
+    result_type operator()();
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    // Writes blocks [firstBlock, firstBlock + blockCount) of a stream, BLOCK_SIZE values per block.
+    // Runs 8 (AVX2) or 4 (SSE2) blocks at a time.
+    static void generate(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint32_t *values, size_t blockCount);
+    // The raw bijection, for custom counter layouts
+    static void generateBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]);
+
+private:
+    void refill();
+
+    uint64_t mSeed, mStream;
+    uint64_t mBlock; // index of the next block to generate
+    uint32_t mBuffer[BLOCK_SIZE];
+    size_t mBufferIndex;
+};
+
+using RandomPhilox = RandomGenerator<Philox4x32>;
+
+HD_FORCEINLINE uint32_t Philox4x32::nextUint32() {
+    if (mBufferIndex == BLOCK_SIZE) {
+        refill();
+    }
+    return mBuffer[mBufferIndex++];
+}
+
+HD_FORCEINLINE uint64_t Philox4x32::nextUint64() {
+    uint64_t low = nextUint32();
+    return low | (static_cast<uint64_t>(nextUint32()) << 32);
+}
+
+HD_FORCEINLINE Philox4x32::result_type Philox4x32::operator()() {
+    return nextUint32();
+}
+
+}
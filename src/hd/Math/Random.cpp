@@ -0,0 +1,199 @@
+#include "Random.hpp"
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX2)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+// Below this count seeding the extra streams costs more than it saves
+static const size_t MIN_SIMD_FILL_COUNT = 64;
+
+static uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+#if defined(HD_SIMD_AVX2)
+static HD_FORCEINLINE __m256i rotl64x4(__m256i x, int k) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+#elif defined(HD_SIMD_SSE2)
+static HD_FORCEINLINE __m128i rotl64x2(__m128i x, int k) {
+    return _mm_or_si128(_mm_slli_epi64(x, k), _mm_srli_epi64(x, 64 - k));
+}
+#endif
+
+// Runs four xoshiro256** streams side by side, state[word][lane], writing count values (a multiple of 4)
+// with the lanes interleaved. Multiplications by 5 and 9 are shifts and adds, so 64 bit lanes work on SSE2.
+static void fillXoshiro4(uint64_t state[4][4], uint64_t *values, size_t count) {
+#if defined(HD_SIMD_AVX2)
+    __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[0]));
+    __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[1]));
+    __m256i s2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[2]));
+    __m256i s3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(state[3]));
+    for (size_t i = 0; i < count; i += 4) {
+        __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+        x = rotl64x4(x, 7);
+        __m256i result = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + i), result);
+
+        __m256i t = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = rotl64x4(s3, 45);
+    }
+#elif defined(HD_SIMD_SSE2)
+    __m128i s0[2], s1[2], s2[2], s3[2];
+    for (int j = 0; j < 2; j++) {
+        s0[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state[0] + j*2));
+        s1[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state[1] + j*2));
+        s2[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state[2] + j*2));
+        s3[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state[3] + j*2));
+    }
+    for (size_t i = 0; i < count; i += 4) {
+        for (int j = 0; j < 2; j++) {
+            __m128i x = _mm_add_epi64(_mm_slli_epi64(s1[j], 2), s1[j]);
+            x = rotl64x2(x, 7);
+            __m128i result = _mm_add_epi64(_mm_slli_epi64(x, 3), x);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(values + i + j*2), result);
+
+            __m128i t = _mm_slli_epi64(s1[j], 17);
+            s2[j] = _mm_xor_si128(s2[j], s0[j]);
+            s3[j] = _mm_xor_si128(s3[j], s1[j]);
+            s1[j] = _mm_xor_si128(s1[j], s2[j]);
+            s0[j] = _mm_xor_si128(s0[j], s3[j]);
+            s2[j] = _mm_xor_si128(s2[j], t);
+            s3[j] = rotl64x2(s3[j], 45);
+        }
+    }
+#else
+    for (size_t i = 0; i < count; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t s1 = state[1][lane];
+            uint64_t x = s1*5;
+            values[i + lane] = ((x << 7) | (x >> 57))*9;
+            uint64_t t = s1 << 17;
+            state[2][lane] ^= state[0][lane];
+            state[3][lane] ^= s1;
+            state[1][lane] ^= state[2][lane];
+            state[0][lane] ^= state[3][lane];
+            state[2][lane] ^= t;
+            state[3][lane] = (state[3][lane] << 45) | (state[3][lane] >> 19);
+        }
+    }
+#endif
+}
+
+Xoshiro256::Xoshiro256() {
+    seed(0);
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed) {
+    this->seed(seed);
+}
+
+void Xoshiro256::seed(uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        mState[i] = splitMix64(seed);
+    }
+}
+
+void Xoshiro256::jump() {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+
+    uint64_t state[4] = { 0, 0, 0, 0 };
+    for (uint64_t jump : JUMP) {
+        for (int bit = 0; bit < 64; bit++) {
+            if (jump & (static_cast<uint64_t>(1) << bit)) {
+                for (int i = 0; i < 4; i++) {
+                    state[i] ^= mState[i];
+                }
+            }
+            nextUint64();
+        }
+    }
+    std::memcpy(mState, state, sizeof(mState));
+}
+
+void Xoshiro256::fill(uint64_t *values, size_t count) {
+    size_t simdCount = count >= MIN_SIMD_FILL_COUNT ? count / 4*4 : 0;
+    if (simdCount > 0) {
+        // Every lane gets a fresh state derived from this stream, like separately seeded generators
+        uint64_t state[4][4];
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t laneSeed = nextUint64();
+            for (int word = 0; word < 4; word++) {
+                state[word][lane] = splitMix64(laneSeed);
+            }
+        }
+        fillXoshiro4(state, values, simdCount);
+    }
+    for (size_t i = simdCount; i < count; i++) {
+        values[i] = nextUint64();
+    }
+}
+
+PCG32::PCG32() {
+    seed(0);
+}
+
+PCG32::PCG32(uint64_t seed, uint64_t stream) {
+    this->seed(seed, stream);
+}
+
+void PCG32::seed(uint64_t seed, uint64_t stream) {
+    mState = 0;
+    mIncrement = (stream << 1) | 1;
+    nextUint32();
+    mState += seed;
+    nextUint32();
+}
+
+void PCG32::advance(uint64_t delta) {
+    // Square and multiply over the affine step, see Brown, "Random Number Generation with Arbitrary Stride"
+    uint64_t accMult = 1, accPlus = 0;
+    uint64_t curMult = MULTIPLIER, curPlus = mIncrement;
+    while (delta > 0) {
+        if (delta & 1) {
+            accMult *= curMult;
+            accPlus = accPlus*curMult + curPlus;
+        }
+        curPlus = (curMult + 1)*curPlus;
+        curMult *= curMult;
+        delta >>= 1;
+    }
+    mState = accMult*mState + accPlus;
+}
+
+void PCG32::fill(uint64_t *values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = nextUint64();
+    }
+}
+
+void RandomBits::toFloats(const uint64_t *bits, size_t count, float *values, float min, float max) {
+    // Top 24 bits of each 32 bit half map exactly to a float in [0, 1)
+    const float scale = (max - min)*(1.0f / 16777216.0f);
+    size_t i = 0;
+#if defined(HD_SIMD_SSE2)
+    const __m128 minVec = _mm_set1_ps(min);
+    const __m128 scaleVec = _mm_set1_ps(scale);
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bits + i)), 8);
+        __m128 f = _mm_add_ps(minVec, _mm_mul_ps(_mm_cvtepi32_ps(v), scaleVec));
+        _mm_storeu_ps(values + i*2, f);
+    }
+#endif
+    for (; i < count; i++) {
+        values[i*2] = min + static_cast<float>(static_cast<uint32_t>(bits[i]) >> 8)*scale;
+        values[i*2 + 1] = min + static_cast<float>(static_cast<uint32_t>(bits[i] >> 32) >> 8)*scale;
+    }
+}
+
+}
@@ -0,0 +1,296 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace hd {
+
+// xoshiro256** by Blackman and Vigna, 256 bits of state and a period of 2^256 - 1. Satisfies
+// UniformRandomBitGenerator, so it also works with the std distributions.
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    Xoshiro256();
+    explicit Xoshiro256(uint64_t seed);
+
+    // Expands the seed with splitmix64, any value including zero is fine
+    void seed(uint64_t seed);
+    uint64_t nextUint64();
+    uint32_t nextUint32();
+    // Advances the state by 2^128 steps, calling it n times gives the start of the n-th non-overlapping stream
+    void jump();
+    // Bulk generation, runs four independent streams seeded from this one with AVX2 or SSE2 when the count is large
+    void fill(uint64_t *values, size_t count);
+
+    result_type operator()();
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+private:
+    uint64_t mState[4];
+};
+
+// pcg32 (XSH RR) by O'Neill, 16 bytes of state, the stream selects one of 2^63 independent sequences.
+// Good for generators embedded in many small objects.
+class PCG32 {
+public:
+    using result_type = uint32_t;
+
+    PCG32();
+    explicit PCG32(uint64_t seed, uint64_t stream = DEFAULT_STREAM);
+
+    void seed(uint64_t seed, uint64_t stream = DEFAULT_STREAM);
+    uint32_t nextUint32();
+    uint64_t nextUint64();
+    // Jumps delta steps ahead in logarithmic time
+    void advance(uint64_t delta);
+    void fill(uint64_t *values, size_t count);
+
+    result_type operator()();
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+private:
+    static const uint64_t DEFAULT_STREAM = 0xda3e39cb94b95bdbULL;
+    static const uint64_t MULTIPLIER = 6364136223846793005ULL;
+
+    uint64_t mState, mIncrement;
+};
+
+class RandomBits : public StaticClass {
+public:
+    // Turns each 64 bit value into two floats between min and max, values must hold count*2 floats
+    static void toFloats(const uint64_t *bits, size_t count, float *values, float min, float max);
+};
+
+// Distributions on top of an engine. Generators are cheap to create and own all their state, give every
+// thread its own one (getThreadLocal) instead of sharing, nothing here locks.
+template<typename Engine>
+class RandomGenerator {
+public:
+    // Default constructed generators use a fixed seed, so sequences are reproducible
+    RandomGenerator();
+    explicit RandomGenerator(uint64_t seed);
+
+    void seed(uint64_t seed);
+
+    uint32_t nextUint32();
+    uint64_t nextUint64();
+    // Uniform in [0, bound) without modulo bias (Lemire's multiply and reject), bound must not be zero
+    uint32_t nextUint32(uint32_t bound);
+    // Uniform in [min, max), min must be less than max
+    int32_t nextInt32(int32_t min, int32_t max);
+    // Uniform in [0, 1) with 24 (float) or 53 (double) random bits
+    float nextFloat();
+    float nextFloat(float min, float max);
+    double nextDouble();
+    bool nextBool();
+    glm::vec2 nextVec2(const glm::vec2 &min, const glm::vec2 &max);
+    glm::vec3 nextVec3(const glm::vec3 &min, const glm::vec3 &max);
+    glm::vec4 nextVec4(const glm::vec4 &min, const glm::vec4 &max);
+    // Uniformly distributed direction
+    glm::vec3 nextUnitVec3();
+
+    // Bulk versions, they may draw from the engine differently than repeated single calls
+    void fillUint32(uint32_t *values, size_t count);
+    void fillFloat(float *values, size_t count);
+    void fillFloat(float *values, size_t count, float min, float max);
+
+    Engine &getEngine();
+
+    // Generator of the calling thread, seeded differently for every thread on first use
+    static RandomGenerator &getThreadLocal();
+
+private:
+    static const size_t FILL_CHUNK_SIZE = 256;
+
+    Engine mEngine;
+};
+
+using Random = RandomGenerator<Xoshiro256>;
+using RandomPCG32 = RandomGenerator<PCG32>;
+
+HD_FORCEINLINE uint64_t Xoshiro256::nextUint64() {
+    uint64_t s1 = mState[1];
+    uint64_t x = s1*5;
+    uint64_t result = ((x << 7) | (x >> 57))*9;
+    uint64_t t = s1 << 17;
+    mState[2] ^= mState[0];
+    mState[3] ^= s1;
+    mState[1] ^= mState[2];
+    mState[0] ^= mState[3];
+    mState[2] ^= t;
+    mState[3] = (mState[3] << 45) | (mState[3] >> 19);
+    return result;
+}
+
+HD_FORCEINLINE uint32_t Xoshiro256::nextUint32() {
+    return static_cast<uint32_t>(nextUint64() >> 32);
+}
+
+HD_FORCEINLINE Xoshiro256::result_type Xoshiro256::operator()() {
+    return nextUint64();
+}
+
+HD_FORCEINLINE uint32_t PCG32::nextUint32() {
+    uint64_t oldState = mState;
+    mState = oldState*MULTIPLIER + mIncrement;
+    uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18) ^ oldState) >> 27);
+    uint32_t rot = static_cast<uint32_t>(oldState >> 59);
+    return (xorShifted >> rot) | (xorShifted << ((~rot + 1) & 31));
+}
+
+HD_FORCEINLINE uint64_t PCG32::nextUint64() {
+    uint64_t high = nextUint32();
+    return (high << 32) | nextUint32();
+}
+
+HD_FORCEINLINE PCG32::result_type PCG32::operator()() {
+    return nextUint32();
+}
+
+template<typename Engine>
+RandomGenerator<Engine>::RandomGenerator() {
+}
+
+template<typename Engine>
+RandomGenerator<Engine>::RandomGenerator(uint64_t seed) : mEngine(seed) {
+}
+
+template<typename Engine>
+void RandomGenerator<Engine>::seed(uint64_t seed) {
+    mEngine.seed(seed);
+}
+
+template<typename Engine>
+HD_FORCEINLINE uint32_t RandomGenerator<Engine>::nextUint32() {
+    return mEngine.nextUint32();
+}
+
+template<typename Engine>
+HD_FORCEINLINE uint64_t RandomGenerator<Engine>::nextUint64() {
+    return mEngine.nextUint64();
+}
+
+template<typename Engine>
+uint32_t RandomGenerator<Engine>::nextUint32(uint32_t bound) {
+    uint64_t m = static_cast<uint64_t>(mEngine.nextUint32())*bound;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < bound) {
+        // Values below threshold would be picked more often than the rest, rarely taken for small bounds
+        uint32_t threshold = (~bound + 1) % bound;
+        while (low < threshold) {
+            m = static_cast<uint64_t>(mEngine.nextUint32())*bound;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+template<typename Engine>
+int32_t RandomGenerator<Engine>::nextInt32(int32_t min, int32_t max) {
+    uint32_t range = static_cast<uint32_t>(max) - static_cast<uint32_t>(min);
+    return static_cast<int32_t>(static_cast<uint32_t>(min) + nextUint32(range));
+}
+
+template<typename Engine>
+HD_FORCEINLINE float RandomGenerator<Engine>::nextFloat() {
+    return static_cast<float>(mEngine.nextUint32() >> 8)*(1.0f / 16777216.0f);
+}
+
+template<typename Engine>
+HD_FORCEINLINE float RandomGenerator<Engine>::nextFloat(float min, float max) {
+    return min + nextFloat()*(max - min);
+}
+
+template<typename Engine>
+double RandomGenerator<Engine>::nextDouble() {
+    return static_cast<double>(mEngine.nextUint64() >> 11)*(1.0 / 9007199254740992.0);
+}
+
+template<typename Engine>
+bool RandomGenerator<Engine>::nextBool() {
+    return (mEngine.nextUint32() >> 31) != 0;
+}
+
+template<typename Engine>
+glm::vec2 RandomGenerator<Engine>::nextVec2(const glm::vec2 &min, const glm::vec2 &max) {
+    float x = nextFloat(min.x, max.x);
+    float y = nextFloat(min.y, max.y);
+    return glm::vec2(x, y);
+}
+
+template<typename Engine>
+glm::vec3 RandomGenerator<Engine>::nextVec3(const glm::vec3 &min, const glm::vec3 &max) {
+    float x = nextFloat(min.x, max.x);
+    float y = nextFloat(min.y, max.y);
+    float z = nextFloat(min.z, max.z);
+    return glm::vec3(x, y, z);
+}
+
+template<typename Engine>
+glm::vec4 RandomGenerator<Engine>::nextVec4(const glm::vec4 &min, const glm::vec4 &max) {
+    float x = nextFloat(min.x, max.x);
+    float y = nextFloat(min.y, max.y);
+    float z = nextFloat(min.z, max.z);
+    float w = nextFloat(min.w, max.w);
+    return glm::vec4(x, y, z, w);
+}
+
+template<typename Engine>
+glm::vec3 RandomGenerator<Engine>::nextUnitVec3() {
+    // Uniform height and angle around the axis give a uniform distribution on the sphere (Archimedes)
+    float z = nextFloat(-1.0f, 1.0f);
+    float angle = nextFloat()*6.28318530718f;
+    float radius = std::sqrt(std::max(1.0f - z*z, 0.0f));
+    return glm::vec3(radius*std::cos(angle), radius*std::sin(angle), z);
+}
+
+template<typename Engine>
+void RandomGenerator<Engine>::fillUint32(uint32_t *values, size_t count) {
+    uint64_t bits[FILL_CHUNK_SIZE];
+    while (count >= 2) {
+        size_t chunkSize = std::min(count / 2, FILL_CHUNK_SIZE);
+        mEngine.fill(bits, chunkSize);
+        std::memcpy(values, bits, chunkSize*sizeof(uint64_t));
+        values += chunkSize*2;
+        count -= chunkSize*2;
+    }
+    if (count > 0) {
+        *values = mEngine.nextUint32();
+    }
+}
+
+template<typename Engine>
+void RandomGenerator<Engine>::fillFloat(float *values, size_t count) {
+    fillFloat(values, count, 0.0f, 1.0f);
+}
+
+template<typename Engine>
+void RandomGenerator<Engine>::fillFloat(float *values, size_t count, float min, float max) {
+    uint64_t bits[FILL_CHUNK_SIZE];
+    while (count >= 2) {
+        size_t chunkSize = std::min(count / 2, FILL_CHUNK_SIZE);
+        mEngine.fill(bits, chunkSize);
+        RandomBits::toFloats(bits, chunkSize, values, min, max);
+        values += chunkSize*2;
+        count -= chunkSize*2;
+    }
+    if (count > 0) {
+        *values = nextFloat(min, max);
+    }
+}
+
+template<typename Engine>
+Engine &RandomGenerator<Engine>::getEngine() {
+    return mEngine;
+}
+
+template<typename Engine>
+RandomGenerator<Engine> &RandomGenerator<Engine>::getThreadLocal() {
+    thread_local RandomGenerator generator(MathUtils::randomSeed());
+    return generator;
+}
+
+}
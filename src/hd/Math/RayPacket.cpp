@@ -0,0 +1,244 @@
+#include "RayPacket.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(HD_SIMD_SSE2) || defined(HD_SIMD_AVX)
+#   include <immintrin.h>
+#endif
+
+namespace hd {
+
+// A ray parallel to a slab with its origin exactly on one of the planes gives 0*inf = NaN there.
+// Such a ray lies in the slab, so the axis is left unconstrained on both faces and for both signs
+// of zero direction, the SIMD paths below do the same
+static HD_FORCEINLINE bool slabTest(const glm::vec3 &origin, const glm::vec3 &invDir, float maxDist, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, float &dist) {
+    float tNear = 0.0f;
+    float tFar = maxDist;
+    for (int i = 0; i < 3; i++) {
+        float t1 = (aabbMin[i] - origin[i])*invDir[i];
+        float t2 = (aabbMax[i] - origin[i])*invDir[i];
+        if (std::isnan(t1) || std::isnan(t2)) {
+            continue;
+        }
+        tNear = std::max(std::min(t1, t2), tNear);
+        tFar = std::min(std::max(t1, t2), tFar);
+    }
+    dist = tNear <= tFar ? tNear : INFINITY;
+    return tNear <= tFar;
+}
+
+#ifdef HD_SIMD_SSE2
+static HD_FORCEINLINE void slabAxis4(__m128 aabbMin, __m128 aabbMax, __m128 origin, __m128 invDir, __m128 &tNear, __m128 &tFar) {
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(aabbMin, origin), invDir);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(aabbMax, origin), invDir);
+    __m128 inSlab = _mm_cmpunord_ps(t1, t2);
+    __m128 axisNear = _mm_or_ps(_mm_andnot_ps(inSlab, _mm_min_ps(t1, t2)), _mm_and_ps(inSlab, _mm_set1_ps(-INFINITY)));
+    __m128 axisFar = _mm_or_ps(_mm_andnot_ps(inSlab, _mm_max_ps(t1, t2)), _mm_and_ps(inSlab, _mm_set1_ps(INFINITY)));
+    tNear = _mm_max_ps(axisNear, tNear);
+    tFar = _mm_min_ps(axisFar, tFar);
+}
+
+static HD_FORCEINLINE uint32_t storeHits4(__m128 tNear, __m128 tFar, float *dists) {
+    __m128 hit = _mm_cmple_ps(tNear, tFar);
+    _mm_storeu_ps(dists, _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, _mm_set1_ps(INFINITY))));
+    return static_cast<uint32_t>(_mm_movemask_ps(hit));
+}
+#endif
+
+#ifdef HD_SIMD_AVX
+static HD_FORCEINLINE void slabAxis8(__m256 aabbMin, __m256 aabbMax, __m256 origin, __m256 invDir, __m256 &tNear, __m256 &tFar) {
+    __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(aabbMin, origin), invDir);
+    __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(aabbMax, origin), invDir);
+    __m256 inSlab = _mm256_cmp_ps(t1, t2, _CMP_UNORD_Q);
+    tNear = _mm256_max_ps(_mm256_blendv_ps(_mm256_min_ps(t1, t2), _mm256_set1_ps(-INFINITY), inSlab), tNear);
+    tFar = _mm256_min_ps(_mm256_blendv_ps(_mm256_max_ps(t1, t2), _mm256_set1_ps(INFINITY), inSlab), tFar);
+}
+
+static HD_FORCEINLINE uint32_t storeHits8(__m256 tNear, __m256 tFar, float *dists) {
+    __m256 hit = _mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ);
+    _mm256_storeu_ps(dists, _mm256_blendv_ps(_mm256_set1_ps(INFINITY), tNear, hit));
+    return static_cast<uint32_t>(_mm256_movemask_ps(hit));
+}
+#endif
+
+// Padding boxes of a batch are inverted (min > max), which a slab test treats as an infinite box,
+// so lanes past the batch count are masked out explicitly
+static HD_FORCEINLINE uint32_t maskBatchLanes(const AABBBatch &batch, size_t first, size_t laneCount, uint32_t mask, float *dists) {
+    if (first + laneCount <= batch.getCount()) {
+        return mask;
+    }
+    size_t validCount = batch.getCount() > first ? batch.getCount() - first : 0;
+    for (size_t i = validCount; i < laneCount; i++) {
+        dists[i] = INFINITY;
+    }
+    return mask & ((1u << validCount) - 1);
+}
+
+template<typename P>
+static void setPacketLane(P &packet, size_t lane, const PrecomputedRay &ray) {
+    HD_ASSERT(lane < P::SIZE);
+    packet.originX[lane] = ray.origin.x;
+    packet.originY[lane] = ray.origin.y;
+    packet.originZ[lane] = ray.origin.z;
+    packet.invDirX[lane] = ray.invDir.x;
+    packet.invDirY[lane] = ray.invDir.y;
+    packet.invDirZ[lane] = ray.invDir.z;
+    packet.maxDist[lane] = ray.maxDist;
+}
+
+template<typename P>
+static void resetPacket(P &packet) {
+    // Unused lanes never hit anything
+    for (size_t i = 0; i < P::SIZE; i++) {
+        packet.originX[i] = packet.originY[i] = packet.originZ[i] = 0.0f;
+        packet.invDirX[i] = packet.invDirY[i] = packet.invDirZ[i] = INFINITY;
+        packet.maxDist[i] = -1.0f;
+    }
+}
+
+// Tests lanes [first, first + 4) of a packet against one box
+template<typename P>
+static uint32_t intersectPacket4(const P &packet, size_t first, const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, float *dists) {
+#ifdef HD_SIMD_SSE2
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_load_ps(packet.maxDist + first);
+    slabAxis4(_mm_set1_ps(aabbMin.x), _mm_set1_ps(aabbMax.x), _mm_load_ps(packet.originX + first), _mm_load_ps(packet.invDirX + first), tNear, tFar);
+    slabAxis4(_mm_set1_ps(aabbMin.y), _mm_set1_ps(aabbMax.y), _mm_load_ps(packet.originY + first), _mm_load_ps(packet.invDirY + first), tNear, tFar);
+    slabAxis4(_mm_set1_ps(aabbMin.z), _mm_set1_ps(aabbMax.z), _mm_load_ps(packet.originZ + first), _mm_load_ps(packet.invDirZ + first), tNear, tFar);
+    return storeHits4(tNear, tFar, dists);
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < 4; i++) {
+        size_t lane = first + i;
+        glm::vec3 origin(packet.originX[lane], packet.originY[lane], packet.originZ[lane]);
+        glm::vec3 invDir(packet.invDirX[lane], packet.invDirY[lane], packet.invDirZ[lane]);
+        mask |= static_cast<uint32_t>(slabTest(origin, invDir, packet.maxDist[lane], aabbMin, aabbMax, dists[i])) << i;
+    }
+    return mask;
+#endif
+}
+
+PrecomputedRay::PrecomputedRay() : origin(0, 0, 0), dir(0, 0, 0), invDir(INFINITY, INFINITY, INFINITY) {
+    this->maxDist = INFINITY;
+}
+
+PrecomputedRay::PrecomputedRay(const Ray &ray, float maxDist) : origin(ray.origin), dir(ray.dir), invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z) {
+    this->maxDist = maxDist;
+}
+
+bool PrecomputedRay::intersectAABB(const AABB &aabb, float &dist) const {
+    return slabTest(origin, invDir, maxDist, aabb.pos - aabb.size, aabb.pos + aabb.size, dist);
+}
+
+bool PrecomputedRay::intersectAABB(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, float &dist) const {
+    return slabTest(origin, invDir, maxDist, aabbMin, aabbMax, dist);
+}
+
+uint32_t PrecomputedRay::intersectAABB4(const AABBBatch &batch, size_t first, float *dists) const {
+    HD_ASSERT(first % 4 == 0 && first + 4 <= batch.getPaddedCount());
+#ifdef HD_SIMD_SSE2
+    __m128 tNear = _mm_setzero_ps();
+    __m128 tFar = _mm_set1_ps(maxDist);
+    slabAxis4(_mm_loadu_ps(batch.getMinX() + first), _mm_loadu_ps(batch.getMaxX() + first), _mm_set1_ps(origin.x), _mm_set1_ps(invDir.x), tNear, tFar);
+    slabAxis4(_mm_loadu_ps(batch.getMinY() + first), _mm_loadu_ps(batch.getMaxY() + first), _mm_set1_ps(origin.y), _mm_set1_ps(invDir.y), tNear, tFar);
+    slabAxis4(_mm_loadu_ps(batch.getMinZ() + first), _mm_loadu_ps(batch.getMaxZ() + first), _mm_set1_ps(origin.z), _mm_set1_ps(invDir.z), tNear, tFar);
+    return maskBatchLanes(batch, first, 4, storeHits4(tNear, tFar, dists), dists);
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < 4; i++) {
+        size_t j = first + i;
+        glm::vec3 aabbMin(batch.getMinX()[j], batch.getMinY()[j], batch.getMinZ()[j]);
+        glm::vec3 aabbMax(batch.getMaxX()[j], batch.getMaxY()[j], batch.getMaxZ()[j]);
+        mask |= static_cast<uint32_t>(slabTest(origin, invDir, maxDist, aabbMin, aabbMax, dists[i])) << i;
+    }
+    return maskBatchLanes(batch, first, 4, mask, dists);
+#endif
+}
+
+uint32_t PrecomputedRay::intersectAABB8(const AABBBatch &batch, size_t first, float *dists) const {
+    HD_ASSERT(first % 8 == 0 && first + 8 <= batch.getPaddedCount());
+#ifdef HD_SIMD_AVX
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(maxDist);
+    slabAxis8(_mm256_loadu_ps(batch.getMinX() + first), _mm256_loadu_ps(batch.getMaxX() + first), _mm256_set1_ps(origin.x), _mm256_set1_ps(invDir.x), tNear, tFar);
+    slabAxis8(_mm256_loadu_ps(batch.getMinY() + first), _mm256_loadu_ps(batch.getMaxY() + first), _mm256_set1_ps(origin.y), _mm256_set1_ps(invDir.y), tNear, tFar);
+    slabAxis8(_mm256_loadu_ps(batch.getMinZ() + first), _mm256_loadu_ps(batch.getMaxZ() + first), _mm256_set1_ps(origin.z), _mm256_set1_ps(invDir.z), tNear, tFar);
+    return maskBatchLanes(batch, first, 8, storeHits8(tNear, tFar, dists), dists);
+#else
+    return intersectAABB4(batch, first, dists) | (intersectAABB4(batch, first + 4, dists + 4) << 4);
+#endif
+}
+
+size_t PrecomputedRay::intersectAABBBatch(const AABBBatch &batch, std::vector<uint32_t> &indices, std::vector<float> &dists) const {
+    size_t startSize = indices.size();
+    float blockDists[AABBBatch::PADDING];
+    for (size_t i = 0; i < batch.getPaddedCount(); i += AABBBatch::PADDING) {
+        uint32_t mask = intersectAABB8(batch, i, blockDists);
+        while (mask) {
+            int lane = MathUtils::countTrailingZeros(mask);
+            indices.push_back(static_cast<uint32_t>(i) + static_cast<uint32_t>(lane));
+            dists.push_back(blockDists[lane]);
+            mask &= mask - 1;
+        }
+    }
+    return indices.size() - startSize;
+}
+
+bool PrecomputedRay::intersectNearest(const AABBBatch &batch, uint32_t &index, float &dist) const {
+    // Shrinking the ray to the nearest hit so far lets the slab test reject farther boxes
+    PrecomputedRay ray = *this;
+    bool hasHit = false;
+    float blockDists[AABBBatch::PADDING];
+    for (size_t i = 0; i < batch.getPaddedCount(); i += AABBBatch::PADDING) {
+        uint32_t mask = ray.intersectAABB8(batch, i, blockDists);
+        while (mask) {
+            int lane = MathUtils::countTrailingZeros(mask);
+            if (blockDists[lane] <= ray.maxDist) {
+                ray.maxDist = blockDists[lane];
+                index = static_cast<uint32_t>(i) + static_cast<uint32_t>(lane);
+                hasHit = true;
+            }
+            mask &= mask - 1;
+        }
+    }
+    dist = hasHit ? ray.maxDist : INFINITY;
+    return hasHit;
+}
+
+RayPacket4::RayPacket4() {
+    resetPacket(*this);
+}
+
+void RayPacket4::set(size_t lane, const PrecomputedRay &ray) {
+    setPacketLane(*this, lane, ray);
+}
+
+uint32_t RayPacket4::intersectAABB(const AABB &aabb, float *dists) const {
+    return intersectPacket4(*this, 0, aabb.pos - aabb.size, aabb.pos + aabb.size, dists);
+}
+
+RayPacket8::RayPacket8() {
+    resetPacket(*this);
+}
+
+void RayPacket8::set(size_t lane, const PrecomputedRay &ray) {
+    setPacketLane(*this, lane, ray);
+}
+
+uint32_t RayPacket8::intersectAABB(const AABB &aabb, float *dists) const {
+    glm::vec3 aabbMin = aabb.pos - aabb.size;
+    glm::vec3 aabbMax = aabb.pos + aabb.size;
+#ifdef HD_SIMD_AVX
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_load_ps(maxDist);
+    slabAxis8(_mm256_set1_ps(aabbMin.x), _mm256_set1_ps(aabbMax.x), _mm256_load_ps(originX), _mm256_load_ps(invDirX), tNear, tFar);
+    slabAxis8(_mm256_set1_ps(aabbMin.y), _mm256_set1_ps(aabbMax.y), _mm256_load_ps(originY), _mm256_load_ps(invDirY), tNear, tFar);
+    slabAxis8(_mm256_set1_ps(aabbMin.z), _mm256_set1_ps(aabbMax.z), _mm256_load_ps(originZ), _mm256_load_ps(invDirZ), tNear, tFar);
+    return storeHits8(tNear, tFar, dists);
+#else
+    return intersectPacket4(*this, 0, aabbMin, aabbMax, dists) | (intersectPacket4(*this, 4, aabbMin, aabbMax, dists + 4) << 4);
+#endif
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "AABBBatch.hpp"
+
+namespace hd {
+
+// Ray with the inverse direction computed once, for slab tests against many boxes.
+// A box is hit if the ray enters it within [0, maxDist], the reported distance is the entry distance
+// clamped to 0, so rays starting inside a box hit it at 0.
+struct PrecomputedRay {
+    PrecomputedRay();
+    explicit PrecomputedRay(const Ray &ray, float maxDist = INFINITY);
+
+    bool intersectAABB(const AABB &aabb, float &dist) const;
+    bool intersectAABB(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, float &dist) const;
+    // Tests boxes [first, first + 4) or [first, first + 8) of a batch, first must be a multiple of 4 or 8.
+    // Returns the hit mask, distances of missed boxes are set to INFINITY.
+    uint32_t intersectAABB4(const AABBBatch &batch, size_t first, float *dists) const;
+    uint32_t intersectAABB8(const AABBBatch &batch, size_t first, float *dists) const;
+    // Appends indices and distances of all hit boxes, returns the number of hits
+    size_t intersectAABBBatch(const AABBBatch &batch, std::vector<uint32_t> &indices, std::vector<float> &dists) const;
+    bool intersectNearest(const AABBBatch &batch, uint32_t &index, float &dist) const;
+
+    glm::vec3 origin, dir, invDir;
+    float maxDist;
+};
+
+// 4 rays stored lane by lane, tested against one box at a time
+struct alignas(16) RayPacket4 {
+    static const size_t SIZE = 4;
+
+    RayPacket4();
+
+    void set(size_t lane, const PrecomputedRay &ray);
+    // Returns the hit mask, distances of missed lanes are set to INFINITY
+    uint32_t intersectAABB(const AABB &aabb, float *dists) const;
+
+    float originX[SIZE], originY[SIZE], originZ[SIZE];
+    float invDirX[SIZE], invDirY[SIZE], invDirZ[SIZE];
+    float maxDist[SIZE];
+};
+
+struct alignas(32) RayPacket8 {
+    static const size_t SIZE = 8;
+
+    RayPacket8();
+
+    void set(size_t lane, const PrecomputedRay &ray);
+    uint32_t intersectAABB(const AABB &aabb, float *dists) const;
+
+    float originX[SIZE], originY[SIZE], originZ[SIZE];
+    float invDirX[SIZE], invDirY[SIZE], invDirZ[SIZE];
+    float maxDist[SIZE];
+};
+
+}
@@ -0,0 +1,376 @@
+#include "SpatialHashGrid.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+
+namespace hd {
+
+// Cell coordinates are packed into 21 bits per axis
+static const int CELL_COORD_BIAS = 1 << 20;
+static const int CELL_COORD_LIMIT = CELL_COORD_BIAS - 1;
+static const uint64_t CELL_COORD_MASK = (1ull << 21) - 1;
+static const uint64_t EMPTY_CELL_KEY = UINT64_MAX;
+static const size_t MIN_CELL_CAPACITY = 64;
+
+static uint64_t packCellKey(int x, int y, int z) {
+    return (static_cast<uint64_t>(x + CELL_COORD_BIAS) & CELL_COORD_MASK) |
+        ((static_cast<uint64_t>(y + CELL_COORD_BIAS) & CELL_COORD_MASK) << 21) |
+        ((static_cast<uint64_t>(z + CELL_COORD_BIAS) & CELL_COORD_MASK) << 42);
+}
+
+static glm::ivec3 unpackCellKey(uint64_t key) {
+    return glm::ivec3(
+        static_cast<int>(key & CELL_COORD_MASK) - CELL_COORD_BIAS,
+        static_cast<int>((key >> 21) & CELL_COORD_MASK) - CELL_COORD_BIAS,
+        static_cast<int>((key >> 42) & CELL_COORD_MASK) - CELL_COORD_BIAS
+    );
+}
+
+static size_t hashCellKey(uint64_t key, size_t capacity) {
+    return static_cast<size_t>((key*0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+static bool overlaps(const glm::vec3 &min1, const glm::vec3 &max1, const glm::vec3 &min2, const glm::vec3 &max2) {
+    return max1.x >= min2.x && min1.x <= max2.x && max1.y >= min2.y && min1.y <= max2.y && max1.z >= min2.z && min1.z <= max2.z;
+}
+
+static size_t getCellCount(const glm::ivec3 &cellMin, const glm::ivec3 &cellMax) {
+    glm::ivec3 extent = cellMax - cellMin + glm::ivec3(1);
+    return static_cast<size_t>(extent.x)*static_cast<size_t>(extent.y)*static_cast<size_t>(extent.z);
+}
+
+SpatialHashGrid::SpatialHashGrid() {
+    mFreeEntry = INVALID_ID;
+    mUsedCellCount = 0;
+    mCellSize = 1.0f;
+    mInvCellSize = 1.0f;
+    mCount = 0;
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize, size_t reserveCount) : SpatialHashGrid() {
+    create(cellSize, reserveCount);
+}
+
+void SpatialHashGrid::create(float cellSize, size_t reserveCount) {
+    HD_ASSERT(cellSize > 0.0f);
+    destroy();
+    mCellSize = cellSize;
+    mInvCellSize = 1.0f / cellSize;
+
+    // Objects about the size of a cell touch up to 8 cells, usually fewer
+    mObjects.reserve(reserveCount);
+    mFreeObjects.reserve(reserveCount);
+    mEntries.reserve(reserveCount*4);
+    size_t capacity = MIN_CELL_CAPACITY;
+    while (capacity < reserveCount*4) {
+        capacity *= 2;
+    }
+    mCells.assign(capacity, Cell { EMPTY_CELL_KEY, INVALID_ID, 0 });
+    mRehashCells.reserve(capacity);
+}
+
+void SpatialHashGrid::destroy() {
+    mObjects.clear();
+    mFreeObjects.clear();
+    mOversized.clear();
+    mEntries.clear();
+    mFreeEntry = INVALID_ID;
+    mCells.clear();
+    mRehashCells.clear();
+    mUsedCellCount = 0;
+    mCount = 0;
+}
+
+uint32_t SpatialHashGrid::insert(const AABB &aabb) {
+    if (mCells.empty()) {
+        create(mCellSize);
+    }
+
+    uint32_t id;
+    if (!mFreeObjects.empty()) {
+        id = mFreeObjects.back();
+        mFreeObjects.pop_back();
+    }
+    else {
+        id = static_cast<uint32_t>(mObjects.size());
+        mObjects.emplace_back();
+    }
+
+    Object &obj = mObjects[id];
+    obj.aabb = aabb;
+    obj.min = aabb.pos - aabb.size;
+    obj.max = aabb.pos + aabb.size;
+    obj.isAlive = true;
+    computeCellRange(obj.min, obj.max, obj.cellMin, obj.cellMax);
+    link(id);
+    mCount++;
+    return id;
+}
+
+void SpatialHashGrid::move(uint32_t id, const AABB &aabb) {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    Object &obj = mObjects[id];
+    obj.aabb = aabb;
+    obj.min = aabb.pos - aabb.size;
+    obj.max = aabb.pos + aabb.size;
+
+    // Small moves usually stay within the same cells, then the links are kept and only bounds are updated
+    glm::ivec3 cellMin, cellMax;
+    computeCellRange(obj.min, obj.max, cellMin, cellMax);
+    if (cellMin != obj.cellMin || cellMax != obj.cellMax) {
+        unlink(id);
+        obj.cellMin = cellMin;
+        obj.cellMax = cellMax;
+        link(id);
+    }
+    else {
+        for (uint32_t i = obj.firstEntry; i != INVALID_ID; i = mEntries[i].nextOfObject) {
+            mEntries[i].min = obj.min;
+            mEntries[i].max = obj.max;
+        }
+    }
+}
+
+void SpatialHashGrid::remove(uint32_t id) {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    unlink(id);
+    mObjects[id].isAlive = false;
+    mFreeObjects.push_back(id);
+    mCount--;
+}
+
+void SpatialHashGrid::findPairs(std::vector<std::pair<uint32_t, uint32_t>> &pairs) const {
+    pairs.clear();
+    for (const Cell &cell : mCells) {
+        if (cell.count < 2) {
+            continue;
+        }
+
+        // A pair sharing several cells is reported only from the lowest cell both objects touch
+        glm::ivec3 cellPos = unpackCellKey(cell.key);
+        for (uint32_t i = cell.head; i != INVALID_ID; i = mEntries[i].next) {
+            const Entry &entry1 = mEntries[i];
+            for (uint32_t j = entry1.next; j != INVALID_ID; j = mEntries[j].next) {
+                const Entry &entry2 = mEntries[j];
+                if (glm::max(entry1.cellMin, entry2.cellMin) != cellPos || !overlaps(entry1.min, entry1.max, entry2.min, entry2.max)) {
+                    continue;
+                }
+                pairs.emplace_back(std::min(entry1.object, entry2.object), std::max(entry1.object, entry2.object));
+            }
+        }
+    }
+
+    for (uint32_t oversizedId : mOversized) {
+        const Object &oversized = mObjects[oversizedId];
+        for (uint32_t id = 0; id < mObjects.size(); id++) {
+            const Object &obj = mObjects[id];
+            if (!obj.isAlive || id == oversizedId || (obj.oversizedIndex != INVALID_ID && id < oversizedId)) {
+                continue;
+            }
+            if (overlaps(oversized.min, oversized.max, obj.min, obj.max)) {
+                pairs.emplace_back(std::min(id, oversizedId), std::max(id, oversizedId));
+            }
+        }
+    }
+}
+
+size_t SpatialHashGrid::queryAABB(const AABB &aabb, std::vector<uint32_t> &ids) const {
+    size_t startSize = ids.size();
+    glm::vec3 queryMin = aabb.pos - aabb.size;
+    glm::vec3 queryMax = aabb.pos + aabb.size;
+    glm::ivec3 cellMin, cellMax;
+    computeCellRange(queryMin, queryMax, cellMin, cellMax);
+
+    if (getCellCount(cellMin, cellMax) > mUsedCellCount) {
+        // The query covers more cells than exist, testing objects directly is cheaper
+        for (uint32_t id = 0; id < mObjects.size(); id++) {
+            const Object &obj = mObjects[id];
+            if (obj.isAlive && obj.oversizedIndex == INVALID_ID && overlaps(queryMin, queryMax, obj.min, obj.max)) {
+                ids.push_back(id);
+            }
+        }
+    }
+    else {
+        for (int z = cellMin.z; z <= cellMax.z; z++) {
+            for (int y = cellMin.y; y <= cellMax.y; y++) {
+                for (int x = cellMin.x; x <= cellMax.x; x++) {
+                    size_t cellIndex = findCell(packCellKey(x, y, z));
+                    if (cellIndex == SIZE_MAX) {
+                        continue;
+                    }
+                    glm::ivec3 cellPos(x, y, z);
+                    for (uint32_t i = mCells[cellIndex].head; i != INVALID_ID; i = mEntries[i].next) {
+                        const Entry &entry = mEntries[i];
+                        if (glm::max(entry.cellMin, cellMin) == cellPos && overlaps(queryMin, queryMax, entry.min, entry.max)) {
+                            ids.push_back(entry.object);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (uint32_t id : mOversized) {
+        if (overlaps(queryMin, queryMax, mObjects[id].min, mObjects[id].max)) {
+            ids.push_back(id);
+        }
+    }
+    return ids.size() - startSize;
+}
+
+const AABB &SpatialHashGrid::getAABB(uint32_t id) const {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    return mObjects[id].aabb;
+}
+
+float SpatialHashGrid::getCellSize() const {
+    return mCellSize;
+}
+
+size_t SpatialHashGrid::getCount() const {
+    return mCount;
+}
+
+void SpatialHashGrid::computeCellRange(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, glm::ivec3 &cellMin, glm::ivec3 &cellMax) const {
+    float limit = static_cast<float>(CELL_COORD_LIMIT);
+    cellMin = glm::ivec3(glm::clamp(glm::floor(aabbMin*mInvCellSize), -limit, limit));
+    cellMax = glm::ivec3(glm::clamp(glm::floor(aabbMax*mInvCellSize), -limit, limit));
+}
+
+void SpatialHashGrid::link(uint32_t id) {
+    Object &obj = mObjects[id];
+    obj.firstEntry = INVALID_ID;
+    obj.oversizedIndex = INVALID_ID;
+    if (getCellCount(obj.cellMin, obj.cellMax) > MAX_CELLS_PER_OBJECT) {
+        obj.oversizedIndex = static_cast<uint32_t>(mOversized.size());
+        mOversized.push_back(id);
+        return;
+    }
+
+    for (int z = obj.cellMin.z; z <= obj.cellMax.z; z++) {
+        for (int y = obj.cellMin.y; y <= obj.cellMax.y; y++) {
+            for (int x = obj.cellMin.x; x <= obj.cellMax.x; x++) {
+                uint32_t entryIndex;
+                if (mFreeEntry != INVALID_ID) {
+                    entryIndex = mFreeEntry;
+                    mFreeEntry = mEntries[entryIndex].next;
+                }
+                else {
+                    entryIndex = static_cast<uint32_t>(mEntries.size());
+                    mEntries.emplace_back();
+                }
+
+                uint64_t key = packCellKey(x, y, z);
+                Cell &cell = mCells[findOrAddCell(key)];
+                Entry &entry = mEntries[entryIndex];
+                entry.cellKey = key;
+                entry.min = obj.min;
+                entry.max = obj.max;
+                entry.cellMin = obj.cellMin;
+                entry.object = id;
+                entry.prev = INVALID_ID;
+                entry.next = cell.head;
+                entry.nextOfObject = obj.firstEntry;
+                if (cell.head != INVALID_ID) {
+                    mEntries[cell.head].prev = entryIndex;
+                }
+                cell.head = entryIndex;
+                cell.count++;
+                obj.firstEntry = entryIndex;
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::unlink(uint32_t id) {
+    Object &obj = mObjects[id];
+    if (obj.oversizedIndex != INVALID_ID) {
+        uint32_t lastId = mOversized.back();
+        mOversized[obj.oversizedIndex] = lastId;
+        mObjects[lastId].oversizedIndex = obj.oversizedIndex;
+        mOversized.pop_back();
+        obj.oversizedIndex = INVALID_ID;
+        return;
+    }
+
+    uint32_t entryIndex = obj.firstEntry;
+    while (entryIndex != INVALID_ID) {
+        Entry &entry = mEntries[entryIndex];
+        Cell &cell = mCells[findCell(entry.cellKey)];
+        if (entry.prev != INVALID_ID) {
+            mEntries[entry.prev].next = entry.next;
+        }
+        else {
+            cell.head = entry.next;
+        }
+        if (entry.next != INVALID_ID) {
+            mEntries[entry.next].prev = entry.prev;
+        }
+        // Cells left empty stay in the table until the next rehash, objects often come back to them
+        cell.count--;
+
+        uint32_t nextEntry = entry.nextOfObject;
+        entry.next = mFreeEntry;
+        mFreeEntry = entryIndex;
+        entryIndex = nextEntry;
+    }
+    obj.firstEntry = INVALID_ID;
+}
+
+size_t SpatialHashGrid::findCell(uint64_t key) const {
+    size_t mask = mCells.size() - 1;
+    for (size_t i = hashCellKey(key, mCells.size());; i = (i + 1) & mask) {
+        if (mCells[i].key == key) {
+            return i;
+        }
+        if (mCells[i].key == EMPTY_CELL_KEY) {
+            return SIZE_MAX;
+        }
+    }
+}
+
+size_t SpatialHashGrid::findOrAddCell(uint64_t key) {
+    size_t index = findCell(key);
+    if (index != SIZE_MAX) {
+        return index;
+    }
+
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((mUsedCellCount + 1)*2 > mCells.size()) {
+        rehash();
+    }
+    size_t mask = mCells.size() - 1;
+    for (index = hashCellKey(key, mCells.size()); mCells[index].key != EMPTY_CELL_KEY; index = (index + 1) & mask) {
+    }
+    mCells[index] = Cell { key, INVALID_ID, 0 };
+    mUsedCellCount++;
+    return index;
+}
+
+void SpatialHashGrid::rehash() {
+    // Empty cells are dropped, the table only grows when most cells are actually occupied
+    size_t occupiedCount = 0;
+    for (const Cell &cell : mCells) {
+        occupiedCount += cell.count > 0 ? 1 : 0;
+    }
+    size_t capacity = mCells.size();
+    while ((occupiedCount + 1)*4 > capacity) {
+        capacity *= 2;
+    }
+
+    mRehashCells.assign(capacity, Cell { EMPTY_CELL_KEY, INVALID_ID, 0 });
+    size_t mask = capacity - 1;
+    for (const Cell &cell : mCells) {
+        if (cell.count == 0) {
+            continue;
+        }
+        size_t index = hashCellKey(cell.key, capacity);
+        while (mRehashCells[index].key != EMPTY_CELL_KEY) {
+            index = (index + 1) & mask;
+        }
+        mRehashCells[index] = cell;
+    }
+    mCells.swap(mRehashCells);
+    mUsedCellCount = occupiedCount;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <utility>
+#include <vector>
+
+namespace hd {
+
+// Broad-phase over a uniform grid of cubic cells stored in an open addressing hash table, so only
+// occupied cells take memory. Objects are linked into every cell their box touches, objects touching
+// more than MAX_CELLS_PER_OBJECT cells are kept aside and tested against everything.
+// Once the tables have grown to the working set, insert/move/remove/findPairs don't allocate.
+class SpatialHashGrid : public Noncopyable {
+public:
+    static const uint32_t INVALID_ID = UINT32_MAX;
+    static const size_t MAX_CELLS_PER_OBJECT = 64;
+
+    SpatialHashGrid();
+    explicit SpatialHashGrid(float cellSize, size_t reserveCount = 0);
+
+    void create(float cellSize, size_t reserveCount = 0);
+    void destroy();
+
+    uint32_t insert(const AABB &aabb);
+    void move(uint32_t id, const AABB &aabb);
+    void remove(uint32_t id);
+
+    // Overlapping pairs are reported once with the lower id first, touching boxes count as overlapping
+    // as in AABB::intersectAABB. The vector is cleared first, reuse it between frames to avoid allocations.
+    void findPairs(std::vector<std::pair<uint32_t, uint32_t>> &pairs) const;
+    // Appends ids of the objects overlapping the box, returns the number of appended ids
+    size_t queryAABB(const AABB &aabb, std::vector<uint32_t> &ids) const;
+
+    const AABB &getAABB(uint32_t id) const;
+    float getCellSize() const;
+    size_t getCount() const;
+
+private:
+    struct Object {
+        AABB aabb;
+        glm::vec3 min, max;
+        glm::ivec3 cellMin, cellMax;
+        uint32_t firstEntry;
+        uint32_t oversizedIndex;
+        bool isAlive;
+    };
+
+    // Link of one object into one cell, entries of a cell form a doubly linked list. Bounds are
+    // duplicated from the object, so walking a cell touches nothing but its entries.
+    struct Entry {
+        uint64_t cellKey;
+        glm::vec3 min;
+        uint32_t object;
+        glm::vec3 max;
+        uint32_t prev;
+        glm::ivec3 cellMin;
+        uint32_t next;
+        uint32_t nextOfObject;
+    };
+
+    struct Cell {
+        uint64_t key;
+        uint32_t head;
+        uint32_t count;
+    };
+
+    void computeCellRange(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax, glm::ivec3 &cellMin, glm::ivec3 &cellMax) const;
+    void link(uint32_t id);
+    void unlink(uint32_t id);
+    size_t findCell(uint64_t key) const;
+    size_t findOrAddCell(uint64_t key);
+    void rehash();
+
+    std::vector<Object> mObjects;
+    std::vector<uint32_t> mFreeObjects;
+    std::vector<uint32_t> mOversized;
+    std::vector<Entry> mEntries;
+    uint32_t mFreeEntry;
+    std::vector<Cell> mCells, mRehashCells;
+    size_t mUsedCellCount;
+    float mCellSize, mInvCellSize;
+    size_t mCount;
+};
+
+}
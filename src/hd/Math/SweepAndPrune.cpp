@@ -0,0 +1,296 @@
+#include "SweepAndPrune.hpp"
+#include "../Core/Log.hpp"
+#include <algorithm>
+
+namespace hd {
+
+static uint64_t makePairKey(uint32_t id1, uint32_t id2) {
+    return id1 < id2 ? (static_cast<uint64_t>(id1) << 32) | id2 : (static_cast<uint64_t>(id2) << 32) | id1;
+}
+
+static uint32_t getObjectId(uint32_t data) {
+    return data >> 1;
+}
+
+static bool isMaxEndpoint(uint32_t data) {
+    return (data & 1) != 0;
+}
+
+// On equal values min endpoints go first, so touching boxes are ordered as overlapping
+static bool isBefore(float value, uint32_t data, float otherValue, uint32_t otherData) {
+    return value < otherValue || (value == otherValue && !isMaxEndpoint(data) && isMaxEndpoint(otherData));
+}
+
+static void eraseId(std::vector<uint32_t> &ids, uint32_t id) {
+    auto it = std::find(ids.begin(), ids.end(), id);
+    *it = ids.back();
+    ids.pop_back();
+}
+
+static bool overlaps(const glm::vec3 &min1, const glm::vec3 &max1, const glm::vec3 &min2, const glm::vec3 &max2) {
+    return max1.x >= min2.x && min1.x <= max2.x && max1.y >= min2.y && min1.y <= max2.y && max1.z >= min2.z && min1.z <= max2.z;
+}
+
+SweepAndPrune::SweepAndPrune() {
+    mCount = 0;
+    mInsertedCount = 0;
+}
+
+uint32_t SweepAndPrune::insert(const AABB &aabb) {
+    uint32_t id;
+    if (!mFreeObjects.empty()) {
+        id = mFreeObjects.back();
+        mFreeObjects.pop_back();
+    }
+    else {
+        id = static_cast<uint32_t>(mObjects.size());
+        HD_ASSERT(id < (1u << 31));
+        mObjects.emplace_back();
+    }
+
+    Object &obj = mObjects[id];
+    obj.aabb = aabb;
+    obj.min = aabb.pos - aabb.size;
+    obj.max = aabb.pos + aabb.size;
+    obj.isAlive = true;
+
+    // Appended endpoints act as if the box was to the right of everything, the next update sorts
+    // them into place and reports the overlaps found on the way
+    for (int axis = 0; axis < 3; axis++) {
+        std::vector<Endpoint> &endpoints = mAxes[axis];
+        obj.minIndex[axis] = static_cast<uint32_t>(endpoints.size());
+        endpoints.push_back({ obj.min[axis], id << 1 });
+        obj.maxIndex[axis] = static_cast<uint32_t>(endpoints.size());
+        endpoints.push_back({ obj.max[axis], (id << 1) | 1 });
+    }
+    mCount++;
+    mInsertedCount++;
+    return id;
+}
+
+void SweepAndPrune::move(uint32_t id, const AABB &aabb) {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    Object &obj = mObjects[id];
+    obj.aabb = aabb;
+    obj.min = aabb.pos - aabb.size;
+    obj.max = aabb.pos + aabb.size;
+    for (int axis = 0; axis < 3; axis++) {
+        mAxes[axis][obj.minIndex[axis]].value = obj.min[axis];
+        mAxes[axis][obj.maxIndex[axis]].value = obj.max[axis];
+    }
+}
+
+void SweepAndPrune::remove(uint32_t id) {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    Object &obj = mObjects[id];
+    obj.isAlive = false;
+    mRemovedObjects.push_back(id);
+    mCount--;
+
+    // Pairs are dropped right away, the endpoints are taken out of the axes in the next update
+    for (uint32_t other : obj.pairs) {
+        uint64_t key = makePairKey(id, other);
+        mPairs.erase(key);
+        touchPair(key, true);
+        eraseId(mObjects[other].pairs, id);
+    }
+    obj.pairs.clear();
+}
+
+void SweepAndPrune::clear() {
+    for (int axis = 0; axis < 3; axis++) {
+        mAxes[axis].clear();
+    }
+    mObjects.clear();
+    mFreeObjects.clear();
+    mRemovedObjects.clear();
+    mPairs.clear();
+    mTouchedPairs.clear();
+    mCount = 0;
+    mInsertedCount = 0;
+}
+
+void SweepAndPrune::update(SweepAndPrunePairs &addedPairs, SweepAndPrunePairs &removedPairs) {
+    addedPairs.clear();
+    removedPairs.clear();
+    if (!mRemovedObjects.empty()) {
+        compact();
+    }
+
+    // Every new object may travel across the whole axis, past some point sorting from scratch is cheaper
+    if (mInsertedCount > 64 && mInsertedCount*8 > mCount) {
+        rebuild();
+    }
+    else {
+        for (int axis = 0; axis < 3; axis++) {
+            sortAxis(axis);
+        }
+    }
+    mInsertedCount = 0;
+
+    // A pair may have been added and removed again during one update, report only net changes
+    for (const auto &touched : mTouchedPairs) {
+        bool isOverlapping = mPairs.count(touched.first) > 0;
+        if (isOverlapping == touched.second) {
+            continue;
+        }
+        auto pair = std::make_pair(static_cast<uint32_t>(touched.first >> 32), static_cast<uint32_t>(touched.first));
+        if (isOverlapping) {
+            addedPairs.push_back(pair);
+        }
+        else {
+            removedPairs.push_back(pair);
+        }
+    }
+    mTouchedPairs.clear();
+}
+
+void SweepAndPrune::getPairs(SweepAndPrunePairs &pairs) const {
+    pairs.clear();
+    pairs.reserve(mPairs.size());
+    for (uint64_t key : mPairs) {
+        pairs.emplace_back(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+    }
+}
+
+bool SweepAndPrune::isOverlapping(uint32_t id1, uint32_t id2) const {
+    return mPairs.count(makePairKey(id1, id2)) > 0;
+}
+
+const AABB &SweepAndPrune::getAABB(uint32_t id) const {
+    HD_ASSERT(id < mObjects.size() && mObjects[id].isAlive);
+    return mObjects[id].aabb;
+}
+
+size_t SweepAndPrune::getPairCount() const {
+    return mPairs.size();
+}
+
+size_t SweepAndPrune::getCount() const {
+    return mCount;
+}
+
+void SweepAndPrune::sortAxis(int axis) {
+    std::vector<Endpoint> &endpoints = mAxes[axis];
+    for (size_t i = 1; i < endpoints.size(); i++) {
+        Endpoint endpoint = endpoints[i];
+        uint32_t id = getObjectId(endpoint.data);
+        bool isMax = isMaxEndpoint(endpoint.data);
+
+        size_t j = i;
+        while (j > 0) {
+            const Endpoint &prev = endpoints[j - 1];
+            if (!isBefore(endpoint.value, endpoint.data, prev.value, prev.data)) {
+                break;
+            }
+            bool isPrevMax = isMaxEndpoint(prev.data);
+
+            // A min moving left past a max starts an overlap on this axis, a max moving left past a min ends one
+            uint32_t prevId = getObjectId(prev.data);
+            if (!isMax && isPrevMax) {
+                addPair(id, prevId);
+            }
+            else if (isMax && !isPrevMax) {
+                removePair(id, prevId);
+            }
+
+            Object &prevObj = mObjects[prevId];
+            (isPrevMax ? prevObj.maxIndex[axis] : prevObj.minIndex[axis]) = static_cast<uint32_t>(j);
+            endpoints[j] = prev;
+            j--;
+        }
+
+        if (j != i) {
+            endpoints[j] = endpoint;
+            Object &obj = mObjects[id];
+            (isMax ? obj.maxIndex[axis] : obj.minIndex[axis]) = static_cast<uint32_t>(j);
+        }
+    }
+}
+
+void SweepAndPrune::rebuild() {
+    for (int axis = 0; axis < 3; axis++) {
+        std::vector<Endpoint> &endpoints = mAxes[axis];
+        std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint &a, const Endpoint &b) {
+            return isBefore(a.value, a.data, b.value, b.data);
+        });
+        for (size_t i = 0; i < endpoints.size(); i++) {
+            Object &obj = mObjects[getObjectId(endpoints[i].data)];
+            (isMaxEndpoint(endpoints[i].data) ? obj.maxIndex[axis] : obj.minIndex[axis]) = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Collect the pairs from scratch with one sweep along x, the touched states keep the events net
+    for (uint64_t key : mPairs) {
+        touchPair(key, true);
+    }
+    mPairs.clear();
+    for (Object &obj : mObjects) {
+        obj.pairs.clear();
+    }
+
+    mActive.clear();
+    for (const Endpoint &endpoint : mAxes[0]) {
+        uint32_t id = getObjectId(endpoint.data);
+        if (isMaxEndpoint(endpoint.data)) {
+            // Active lists stay short, a linear search is cheaper than keeping positions
+            auto it = std::find(mActive.begin(), mActive.end(), id);
+            *it = mActive.back();
+            mActive.pop_back();
+            continue;
+        }
+        for (uint32_t other : mActive) {
+            addPair(id, other);
+        }
+        mActive.push_back(id);
+    }
+}
+
+void SweepAndPrune::compact() {
+    // Dropping endpoints keeps the relative order of the rest, so the axes stay sorted
+    for (int axis = 0; axis < 3; axis++) {
+        std::vector<Endpoint> &endpoints = mAxes[axis];
+        size_t count = 0;
+        for (size_t i = 0; i < endpoints.size(); i++) {
+            Object &obj = mObjects[getObjectId(endpoints[i].data)];
+            if (!obj.isAlive) {
+                continue;
+            }
+            (isMaxEndpoint(endpoints[i].data) ? obj.maxIndex[axis] : obj.minIndex[axis]) = static_cast<uint32_t>(count);
+            endpoints[count++] = endpoints[i];
+        }
+        endpoints.resize(count);
+    }
+    mFreeObjects.insert(mFreeObjects.end(), mRemovedObjects.begin(), mRemovedObjects.end());
+    mRemovedObjects.clear();
+}
+
+void SweepAndPrune::addPair(uint32_t id1, uint32_t id2) {
+    const Object &obj1 = mObjects[id1];
+    const Object &obj2 = mObjects[id2];
+    if (!overlaps(obj1.min, obj1.max, obj2.min, obj2.max)) {
+        return;
+    }
+    uint64_t key = makePairKey(id1, id2);
+    if (mPairs.insert(key).second) {
+        touchPair(key, false);
+        mObjects[id1].pairs.push_back(id2);
+        mObjects[id2].pairs.push_back(id1);
+    }
+}
+
+void SweepAndPrune::removePair(uint32_t id1, uint32_t id2) {
+    uint64_t key = makePairKey(id1, id2);
+    if (mPairs.erase(key) > 0) {
+        touchPair(key, true);
+        eraseId(mObjects[id1].pairs, id2);
+        eraseId(mObjects[id2].pairs, id1);
+    }
+}
+
+void SweepAndPrune::touchPair(uint64_t key, bool isOverlapping) {
+    // Only the first change in an update records the state the pair had before
+    mTouchedPairs.emplace(key, isOverlapping);
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "MathUtils.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace hd {
+
+using SweepAndPrunePairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Incremental broad-phase keeping box endpoints sorted on all three axes. Between updates the
+// arrays are nearly sorted, so insertion sort fixes them in close to linear time, and every swap
+// of a min endpoint with a max endpoint is exactly a change of overlap on that axis. Large batches
+// of new objects, like the first update, are handled by a full sort and sweep instead.
+class SweepAndPrune : public Noncopyable {
+public:
+    SweepAndPrune();
+
+    uint32_t insert(const AABB &aabb);
+    void move(uint32_t id, const AABB &aabb);
+    // The id is reused only after the next update
+    void remove(uint32_t id);
+    void clear();
+
+    // Re-sorts the axes and reports overlap changes since the previous update, pairs have the lower id first.
+    // Touching boxes count as overlapping, as in AABB::intersectAABB.
+    void update(SweepAndPrunePairs &addedPairs, SweepAndPrunePairs &removedPairs);
+    void getPairs(SweepAndPrunePairs &pairs) const;
+    bool isOverlapping(uint32_t id1, uint32_t id2) const;
+
+    const AABB &getAABB(uint32_t id) const;
+    size_t getPairCount() const;
+    size_t getCount() const;
+
+private:
+    struct Endpoint {
+        float value;
+        uint32_t data; // object id << 1 | isMax
+    };
+
+    struct Object {
+        AABB aabb;
+        glm::vec3 min, max;
+        uint32_t minIndex[3], maxIndex[3];
+        std::vector<uint32_t> pairs; // ids of the overlapping objects, so removal doesn't scan every pair
+        bool isAlive;
+    };
+
+    void sortAxis(int axis);
+    void rebuild();
+    void compact();
+    void addPair(uint32_t id1, uint32_t id2);
+    void removePair(uint32_t id1, uint32_t id2);
+    void touchPair(uint64_t key, bool isOverlapping);
+
+    std::vector<Endpoint> mAxes[3];
+    std::vector<Object> mObjects;
+    std::vector<uint32_t> mFreeObjects;
+    std::vector<uint32_t> mRemovedObjects;
+    std::unordered_set<uint64_t> mPairs;
+    std::unordered_map<uint64_t, bool> mTouchedPairs; // overlap state at the previous update
+    std::vector<uint32_t> mActive;
+    size_t mInsertedCount;
+    size_t mCount;
+};
+
+}
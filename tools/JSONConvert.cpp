@@ -0,0 +1,67 @@
+#include "hd/Core/JSON.hpp"
+#include "hd/Core/StringUtils.hpp"
+#include "hd/IO/FileStream.hpp"
+#include <cstdio>
+
+// Converts JSON documents between text, CBOR and MessagePack, used to ship data files in a binary format.
+// Usage: JSONConvert <input> <output> [--format text|cbor|msgpack] [--indent N]
+// Formats not given explicitly are taken from the file extensions.
+
+static bool parseFormat(const std::string &name, hd::JSONFormat &format) {
+    if (hd::StringUtils::compare(name, "text", false) || hd::StringUtils::compare(name, "json", false)) {
+        format = hd::JSONFormat::Text;
+    }
+    else if (hd::StringUtils::compare(name, "cbor", false)) {
+        format = hd::JSONFormat::CBOR;
+    }
+    else if (hd::StringUtils::compare(name, "msgpack", false) || hd::StringUtils::compare(name, "mpk", false)) {
+        format = hd::JSONFormat::MessagePack;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static int printUsage() {
+    std::fprintf(stderr, "Usage: JSONConvert <input> <output> [--format text|cbor|msgpack] [--indent N]\n");
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    std::string inputPath, outputPath;
+    hd::JSONFormat format = hd::JSONFormat::Auto;
+    int indent = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            if (!parseFormat(argv[++i], format)) {
+                return printUsage();
+            }
+        }
+        else if (arg == "--indent" && i + 1 < argc) {
+            indent = hd::StringUtils::toInt(argv[++i]);
+        }
+        else if (inputPath.empty()) {
+            inputPath = arg;
+        }
+        else if (outputPath.empty()) {
+            outputPath = arg;
+        }
+        else {
+            return printUsage();
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        return printUsage();
+    }
+
+    hd::JSON json;
+    {
+        hd::FileStream input(inputPath, hd::FileMode::Read);
+        json = hd::JSONUtils::read(input);
+    }
+    hd::FileStream output(outputPath, hd::FileMode::Write);
+    hd::JSONUtils::write(output, json, format, indent);
+    return 0;
+}